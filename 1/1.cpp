@@ -3,9 +3,358 @@
 #include <vector> // std::vector
 #include <algorithm> // std::sort, std::erase, std::unique, std::find
 #include <clocale> // std::setlocale
+#include <string> // std::string
+#include <type_traits> // std::enable_if_t, std::is_base_of_v, std::decay_t
+#include <iterator> // std::prev
+#include <utility> // std::pair
+#include <array> // std::array
+#include <cstdint> // uint64_t
+#include <queue> // std::priority_queue
+#include <tuple> // std::tuple, std::get
+#include <functional> // std::greater
+#include <thread> // std::thread
+#include <set> // std::set
+#include <map> // std::map
+#include <atomic> // std::atomic
+#include <mutex> // std::mutex, std::lock_guard, std::call_once
+#include <chrono> // std::chrono::steady_clock
+#include <iomanip> // std::setw
+#include <new> // std::bad_alloc
+#include <cstring> // std::strcmp, std::strncmp
+#include <fstream> // std::ofstream
+#include <memory> // std::unique_ptr, std::make_unique
+
+// Векторный поиск с выбором реализации во время выполнения (GCC и Clang на x86)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_MEMBERSHIP 1
+#include <immintrin.h> // _mm256_cmpeq_epi32, _mm_cmpeq_epi64
+#else
+#define SIMD_MEMBERSHIP 0
+#endif
 
 using std::size_t;
 
+/**
+ * @brief Сбор статистики выполнения операций (ключ --stats): число вызовов,
+ *        время, обработанные элементы, сравнения и выделения памяти по
+ *        каждой операции. Итоговая таблица выводится в stderr при выходе.
+ *        Пока сбор выключен, замер стоит одной проверки флага
+ */
+class Statistics
+{
+public:
+    struct Counters
+    {
+        size_t calls = 0;
+        long long nanoseconds = 0;
+        size_t elements = 0;
+        size_t probes = 0;
+        size_t allocations = 0;
+        size_t allocatedBytes = 0;
+    };
+
+    static bool isEnabled()
+    {
+        return enabled;
+    }
+
+    /**
+     * @brief Включение сбора статистики и вывода таблицы при выходе из программы
+     */
+    static void enable()
+    {
+        state(); // таблица должна быть создана до регистрации std::atexit
+        enabled = true;
+        std::call_once(registered, []()
+        {
+            std::atexit(print);
+        });
+    }
+
+    /**
+     * @brief Учёт n сравнений (проверок принадлежности)
+     */
+    static void countProbes(size_t n)
+    {
+        if (enabled)
+        {
+            probes.fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Учёт выделения памяти (вызывается из operator new)
+     */
+    static void countAllocation(size_t bytes)
+    {
+        if (enabled)
+        {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+            allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Текущие значения счётчиков сравнений и выделений памяти
+     */
+    static Counters snapshot()
+    {
+        Counters result;
+        result.probes = probes.load(std::memory_order_relaxed);
+        result.allocations = allocations.load(std::memory_order_relaxed);
+        result.allocatedBytes = allocatedBytes.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    static void record(const char* operation, const Counters& delta)
+    {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        Counters& total = s.table[operation];
+        total.calls += delta.calls;
+        total.nanoseconds += delta.nanoseconds;
+        total.elements += delta.elements;
+        total.probes += delta.probes;
+        total.allocations += delta.allocations;
+        total.allocatedBytes += delta.allocatedBytes;
+    }
+
+private:
+    struct State
+    {
+        std::mutex mutex;
+        std::map<std::string, Counters> table;
+    };
+
+    static inline std::atomic<bool> enabled{false}; // читается из рабочих потоков
+    static inline std::once_flag registered; // повторный ключ не регистрирует вывод снова
+    static inline std::atomic<size_t> probes{0};
+    static inline std::atomic<size_t> allocations{0};
+    static inline std::atomic<size_t> allocatedBytes{0};
+
+    static State& state()
+    {
+        static State s;
+        return s;
+    }
+
+    static void print()
+    {
+        enabled = false;
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        // Заголовок выровнен заранее: std::setw считает байты, а не символы кириллицы
+        std::cerr << "\nСтатистика операций:\n"
+                     "операция                   вызовов    время, мкс   элементов   сравнений   выделений          байт\n";
+        for (const auto& entry : s.table)
+        {
+            const Counters& c = entry.second;
+            std::cerr << std::left << std::setw(24) << entry.first << std::right
+                      << std::setw(10) << c.calls << std::setw(14) << c.nanoseconds / 1000
+                      << std::setw(12) << c.elements << std::setw(12) << c.probes
+                      << std::setw(12) << c.allocations << std::setw(14) << c.allocatedBytes << "\n";
+        }
+    }
+};
+
+/**
+ * @brief Трассировка операций (ключ --trace=файл) в формате Chrome trace
+ *        events (chrome://tracing, Perfetto): каждая операция - отрезок
+ *        времени с номером потока, вложенные операции видны как вложенные
+ *        отрезки. События пишутся в буфер своего потока без блокировок,
+ *        файл записывается при выходе из программы
+ */
+class Trace
+{
+public:
+    static bool isEnabled()
+    {
+        return enabled;
+    }
+
+    /**
+     * @brief Включение трассировки с записью в файл path при выходе из программы
+     */
+    static void enable(const std::string& path)
+    {
+        state().path = path; // состояние должно быть создано до регистрации std::atexit
+        origin = std::chrono::steady_clock::now();
+        enabled = true;
+        std::call_once(registered, []()
+        {
+            std::atexit(write);
+        });
+    }
+
+    static void record(const char* operation, std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point finish)
+    {
+        threadBuffer().events.push_back({operation, nanoseconds(start - origin), nanoseconds(finish - start)});
+    }
+
+private:
+    struct Event
+    {
+        const char* operation;
+        long long start;
+        long long duration;
+    };
+
+    struct Buffer
+    {
+        size_t thread = 0;
+        std::vector<Event> events;
+    };
+
+    struct State
+    {
+        std::mutex mutex;
+        std::string path;
+        std::vector< std::unique_ptr<Buffer> > buffers;
+    };
+
+    static inline std::atomic<bool> enabled{false};
+    static inline std::once_flag registered;
+    static inline std::chrono::steady_clock::time_point origin;
+
+    static State& state()
+    {
+        static State s;
+        return s;
+    }
+
+    static long long nanoseconds(std::chrono::steady_clock::duration d)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    }
+
+    // Буфер потока регистрируется один раз, дальше события пишутся без блокировок
+    static Buffer& threadBuffer()
+    {
+        thread_local Buffer* buffer = nullptr;
+        if (buffer == nullptr)
+        {
+            State& s = state();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.buffers.push_back(std::make_unique<Buffer>());
+            buffer = s.buffers.back().get();
+            buffer->thread = s.buffers.size();
+        }
+        return *buffer;
+    }
+
+    // Время в микросекундах с тремя знаками после точки
+    static void writeMicroseconds(std::ostream& out, long long ns)
+    {
+        out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000 << std::setfill(' ');
+    }
+
+    static void write()
+    {
+        enabled = false;
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        std::ofstream out(s.path);
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        for (const std::unique_ptr<Buffer>& buffer : s.buffers)
+        {
+            for (const Event& event : buffer->events)
+            {
+                out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.operation
+                    << "\",\"cat\":\"operation\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread << ",\"ts\":";
+                writeMicroseconds(out, event.start);
+                out << ",\"dur\":";
+                writeMicroseconds(out, event.duration);
+                out << "}";
+                first = false;
+            }
+        }
+        out << "\n]}\n";
+    }
+};
+
+/**
+ * @brief Замер одной операции для статистики и трассировки: от создания
+ *        объекта до его уничтожения. Вложенные замеры учитываются и во
+ *        внешней операции
+ */
+class OperationTimer
+{
+public:
+    OperationTimer(const char* operation, size_t elements)
+        : operation(operation), active(Statistics::isEnabled()), traced(Trace::isEnabled())
+    {
+        if (active)
+        {
+            start = Statistics::snapshot();
+            start.elements = elements;
+        }
+        if (active || traced)
+        {
+            startTime = std::chrono::steady_clock::now();
+        }
+    }
+
+    OperationTimer(const OperationTimer&) = delete;
+    OperationTimer& operator=(const OperationTimer&) = delete;
+
+    ~OperationTimer()
+    {
+        if (!active && !traced)
+        {
+            return;
+        }
+        std::chrono::steady_clock::time_point finishTime = std::chrono::steady_clock::now();
+        if (active)
+        {
+            Statistics::Counters finish = Statistics::snapshot();
+            Statistics::Counters delta;
+            delta.calls = 1;
+            delta.nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(finishTime - startTime).count();
+            delta.elements = start.elements;
+            delta.probes = finish.probes - start.probes;
+            delta.allocations = finish.allocations - start.allocations;
+            delta.allocatedBytes = finish.allocatedBytes - start.allocatedBytes;
+            Statistics::record(operation, delta);
+        }
+        if (traced)
+        {
+            Trace::record(operation, startTime, finishTime);
+        }
+    }
+
+private:
+    const char* operation;
+    bool active;
+    bool traced;
+    Statistics::Counters start;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+// Счётчик выделений памяти для статистики: все выделения через new проходят здесь.
+// operator delete не встраивается, иначе GCC ошибочно считает пару new/free несогласованной
+void* operator new(size_t size)
+{
+    Statistics::countAllocation(size);
+    void* pointer = std::malloc(size != 0 ? size : 1);
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
 /**
  * @brief Удаление из множества повторяющихся элементов
  *
@@ -20,92 +369,1285 @@ inline void normalize(std::vector<T>& x)
 }
 
 /**
- * @brief Проверяет есть ли элемент в массиве
- *
- * @tparam T тип элементов в массиве
- * @param x массив, в котором надо найти элемент
- * @param element элемент, который надо найти
- * @return true если элемент найден
- * @return false если элемент не найден
+ * @brief Линейный поиск элемента в неотсортированном массиве int
+ *
+ * @return size_t позиция первого вхождения или n, если элемента нет
+ */
+size_t findIntScalar(const int* values, size_t n, int element)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (values[i] == element)
+        {
+            return i;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Линейный поиск пары в неотсортированном массиве пар
+ *
+ * @return size_t позиция первого вхождения или n, если пары нет
+ */
+size_t findPairScalar(const std::pair<int, int>* values, size_t n, const std::pair<int, int>& element)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (values[i] == element)
+        {
+            return i;
+        }
+    }
+    return n;
+}
+
+#if SIMD_MEMBERSHIP
+// Векторные варианты просматривают блок из четырёх регистров за итерацию и при
+// совпадении в блоке передают остаток скалярному поиску, который найдёт его в
+// пределах блока. Пара int сравнивается как одно 64-битное слово
+
+__attribute__((target("sse2")))
+size_t findIntSse2(const int* values, size_t n, int element)
+{
+    const __m128i needle = _mm_set1_epi32(element);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i a = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + i)), needle);
+        __m128i b = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + i + 4)), needle);
+        __m128i c = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + i + 8)), needle);
+        __m128i d = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + i + 12)), needle);
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0)
+        {
+            break;
+        }
+    }
+    return i + findIntScalar(values + i, n - i, element);
+}
+
+__attribute__((target("avx2")))
+size_t findIntAvx2(const int* values, size_t n, int element)
+{
+    const __m256i needle = _mm256_set1_epi32(element);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i a = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + i)), needle);
+        __m256i b = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + i + 8)), needle);
+        __m256i c = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + i + 16)), needle);
+        __m256i d = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + i + 24)), needle);
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)) ||
+            !_mm256_testz_si256(_mm256_or_si256(c, d), _mm256_or_si256(c, d)))
+        {
+            break;
+        }
+    }
+    return i + findIntScalar(values + i, n - i, element);
+}
+
+__attribute__((target("sse4.1")))
+size_t findPairSse41(const std::pair<int, int>* values, size_t n, const std::pair<int, int>& element)
+{
+    long long word;
+    std::memcpy(&word, &element, sizeof(word));
+    const __m128i needle = _mm_set1_epi64x(word);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i a = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(values + i)), needle);
+        __m128i b = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(values + i + 2)), needle);
+        __m128i c = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(values + i + 4)), needle);
+        __m128i d = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(values + i + 6)), needle);
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0)
+        {
+            break;
+        }
+    }
+    return i + findPairScalar(values + i, n - i, element);
+}
+
+__attribute__((target("avx2")))
+size_t findPairAvx2(const std::pair<int, int>* values, size_t n, const std::pair<int, int>& element)
+{
+    long long word;
+    std::memcpy(&word, &element, sizeof(word));
+    const __m256i needle = _mm256_set1_epi64x(word);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i a = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(values + i)), needle);
+        __m256i b = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(values + i + 4)), needle);
+        __m256i c = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(values + i + 8)), needle);
+        __m256i d = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(values + i + 12)), needle);
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)) ||
+            !_mm256_testz_si256(_mm256_or_si256(c, d), _mm256_or_si256(c, d)))
+        {
+            break;
+        }
+    }
+    return i + findPairScalar(values + i, n - i, element);
+}
+#endif
+
+/**
+ * @brief Позиция первого вхождения элемента в массив int. Реализация
+ *        выбирается при первом вызове по возможностям процессора: AVX2, SSE2
+ *        или скалярный цикл
+ *
+ * @return size_t позиция первого вхождения или n, если элемента нет
+ */
+size_t findPosition(const int* values, size_t n, int element)
+{
+    using Search = size_t (*)(const int*, size_t, int);
+    static const Search search = []() -> Search
+    {
+#if SIMD_MEMBERSHIP
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return findIntAvx2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return findIntSse2;
+        }
+#endif
+        return findIntScalar;
+    }();
+    return search(values, n, element);
+}
+
+/**
+ * @brief Позиция первого вхождения пары в массив пар. Реализация выбирается
+ *        при первом вызове по возможностям процессора: AVX2, SSE4.1 или
+ *        скалярный цикл
+ *
+ * @return size_t позиция первого вхождения или n, если пары нет
+ */
+size_t findPosition(const std::pair<int, int>* values, size_t n, const std::pair<int, int>& element)
+{
+    using Search = size_t (*)(const std::pair<int, int>*, size_t, const std::pair<int, int>&);
+    static const Search search = []() -> Search
+    {
+#if SIMD_MEMBERSHIP
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return findPairAvx2;
+        }
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            return findPairSse41;
+        }
+#endif
+        return findPairScalar;
+    }();
+    return search(values, n, element);
+}
+
+/**
+ * @brief Позиция первого вхождения элемента произвольного типа (std::find)
+ */
+template<typename T>
+size_t findPosition(const T* values, size_t n, const T& element)
+{
+    return (size_t)(std::find(values, values + n, element) - values);
+}
+
+/**
+ * @brief Двоичный поиск без ветвлений: граница сдвигается условной
+ *        пересылкой, а не переходом, поэтому число шагов не зависит от
+ *        данных и нет ошибок предсказания переходов
+ *
+ * @param values отсортированный массив
+ * @param n длина массива
+ * @param element искомый элемент
+ * @return size_t позиция первого элемента, не меньшего искомого
+ */
+template<typename T>
+size_t branchlessLowerBound(const T* values, size_t n, const T& element)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    const T* base = values;
+    while (n > 1)
+    {
+        size_t half = n / 2;
+        base = (base[half - 1] < element) ? base + half : base;
+        n -= half;
+    }
+
+    return (size_t)(base - values) + ((*base < element) ? 1 : 0);
+}
+
+/**
+ * @brief Галопирующий поиск от позиции from: шаг удваивается, пока элементы
+ *        меньше искомого, затем найденный отрезок досматривается двоичным
+ *        поиском. Для серии возрастающих запросов стоит O(log d), где d -
+ *        расстояние от предыдущей найденной позиции
+ *
+ * @param values отсортированный массив
+ * @param from позиция, до которой все элементы меньше искомого
+ * @param n длина массива
+ * @param element искомый элемент
+ * @return size_t позиция первого элемента, не меньшего искомого
+ */
+template<typename T>
+size_t gallopingLowerBound(const T* values, size_t from, size_t n, const T& element)
+{
+    size_t low = from, bound = 1;
+    while (from + bound <= n && values[from + bound - 1] < element)
+    {
+        low = from + bound;
+        bound *= 2;
+    }
+    size_t high = std::min(n, from + bound);
+
+    return low + branchlessLowerBound(values + low, high - low, element);
+}
+
+/**
+ * @brief Проверка наличия элемента в отсортированном массиве
+ */
+template<typename T>
+bool sortedContains(const T* values, size_t n, const T& element)
+{
+    size_t position = branchlessLowerBound(values, n, element);
+    return position < n && values[position] == element;
+}
+
+/**
+ * @brief Проверяет есть ли элемент в массиве
+ *
+ * @tparam T тип элементов в массиве
+ * @param x массив, в котором надо найти элемент
+ * @param element элемент, который надо найти
+ * @return true если элемент найден
+ * @return false если элемент не найден
+ */
+template<typename T>
+inline bool found(const std::vector<T>& x, const T& element)
+{
+    size_t position = findPosition(x.data(), x.size(), element);
+    Statistics::countProbes(position + ((position != x.size()) ? 1 : 0));
+    return position != x.size();
+}
+
+/**
+ * @brief Задание универсального множества. В данном случае - целые числа
+ *        диапазона [1;100]
+ *
+ * @return std::vector<int> универсальное множество
+ */
+std::vector<int> generateUniversum()
+{
+    std::vector<int> universum(100);
+    for (int i = 0; i < 100; i++)
+    {
+        universum[i] = i + 1;
+    }
+    return universum;
+}
+
+// Универсальное множество
+const std::vector<int> UNIVERSUM = generateUniversum();
+
+/**
+ * @brief Ввод множества
+ * 
+ * @param name имя вводимого множества
+ * @return std::vector<int> введенное множество
+ */
+std::vector<int> inputSet(const std::string& name)
+{
+    OperationTimer timer("inputSet", 0);
+
+    // Ввод множества <name>
+    std::cout << "Введите мощность множества " << name << " (не забывайте, "
+                 "элементы введенного множества при их повторении будет прои"
+                 "гнорированы и мощность множества будет уменьшена): ";
+    size_t size;
+    std::cin >> size;
+
+    std::vector<int> x(size); // создаем множество
+
+    bool badSet = false;
+    do { // Вводим до тех пор, пока не будет введено множество, соответствующее требованиям
+        badSet = false;
+
+        std::cout << "Введите множество " << name << ("ограничение по вводимым числам - "
+                      "целые числа от 1 до 100): ");
+        for (size_t i = 0; i < size; i++)
+        {
+            std::cin >> x[i];
+            if (x[i] < 1 || x[i] > 100) // проверка введенного элемента
+            {
+                badSet = true;
+                std::cout << i + 1 << ("-ый (-ий/-ой) элемент множества"
+                                       " не соответствует нужному диапазону значений!\n");
+            }
+        }
+    } while (badSet);
+
+    return x;
+}
+
+/**
+ * @brief Печатает массив на консоль
+ * 
+ * @tparam T тип элементов в массиве
+ * @param s массив
+ */
+template<typename T>
+void printArray(const std::vector<T>& s)
+{
+    OperationTimer timer("printArray", s.size());
+    std::cout << "{ ";
+    for (size_t i = 0; i < s.size(); i++)
+    {
+       std::cout << s[i] << ((i + 1 != s.size()) ? ", " : " ");
+    }
+    std::cout << "}\n";
+}
+
+/**
+ * @brief Печатает упорядоченное множество на консоль
+ *
+ * @tparam T тип элементов множества
+ * @param s множество
+ */
+template<typename T>
+void printArray(const std::set<T>& s)
+{
+    OperationTimer timer("printArray", s.size());
+    std::cout << "{ ";
+    size_t i = 0;
+    for (const T& element : s)
+    {
+        std::cout << element << ((++i != s.size()) ? ", " : " ");
+    }
+    std::cout << "}\n";
+}
+
+/**
+ * @brief Признак операнда ленивого выражения над множествами
+ */
+struct SetOperandTag {};
+
+/**
+ * @brief Базовый класс ленивого выражения над множествами. Выражение не
+ *        вычисляется при построении: вычисление происходит при присваивании
+ *        в SortedSet за один проход по отсортированным операндам
+ *
+ * @tparam E тип конкретного выражения
+ */
+template<typename E>
+struct SetExpression : SetOperandTag
+{
+    const E& self() const
+    {
+        return static_cast<const E&>(*this);
+    }
+};
+
+/**
+ * @brief Лист выражения - ссылка на отсортированный массив без повторов
+ *        и текущая позиция в нём
+ *
+ * @tparam T тип элементов множества
+ */
+template<typename T>
+class SetReference : public SetExpression< SetReference<T> >
+{
+public:
+    using value_type = T;
+
+    explicit SetReference(const std::vector<T>& x)
+        : current(x.data()), end(x.data() + x.size()), size(x.size())
+    {
+    }
+
+    // Наименьший ещё не просмотренный элемент
+    bool head(T& value) const
+    {
+        if (current == end)
+        {
+            return false;
+        }
+        value = *current;
+        return true;
+    }
+
+    // Принадлежит ли value множеству (все элементы меньше value уже пройдены)
+    bool contains(const T& value) const
+    {
+        return current != end && *current == value;
+    }
+
+    void advance(const T& value)
+    {
+        if (current != end && *current == value)
+        {
+            ++current;
+        }
+    }
+
+    // Верхняя оценка мощности результата
+    size_t bound() const
+    {
+        return size;
+    }
+
+private:
+    const T* current;
+    const T* end;
+    size_t size;
+};
+
+// Операции над признаками принадлежности элемента левому и правому операндам
+struct UniteOperation
+{
+    static bool apply(bool l, bool r) { return l || r; }
+    static size_t bound(size_t l, size_t r) { return l + r; }
+};
+
+struct IntersectOperation
+{
+    static bool apply(bool l, bool r) { return l && r; }
+    static size_t bound(size_t l, size_t r) { return std::min(l, r); }
+};
+
+struct DifferenceOperation
+{
+    static bool apply(bool l, bool r) { return l && !r; }
+    static size_t bound(size_t l, size_t) { return l; }
+};
+
+struct SymmetricalDifferenceOperation
+{
+    static bool apply(bool l, bool r) { return l != r; }
+    static size_t bound(size_t l, size_t r) { return l + r; }
+};
+
+/**
+ * @brief Узел выражения - бинарная операция над двумя подвыражениями
+ *
+ * @tparam L тип левого подвыражения
+ * @tparam R тип правого подвыражения
+ * @tparam Operation операция (UniteOperation, IntersectOperation, ...)
+ */
+template<typename L, typename R, typename Operation>
+class BinarySetExpression : public SetExpression< BinarySetExpression<L, R, Operation> >
+{
+public:
+    using value_type = typename L::value_type;
+
+    BinarySetExpression(const L& l, const R& r)
+        : left(l), right(r)
+    {
+    }
+
+    bool head(value_type& value) const
+    {
+        value_type l, r;
+        bool hasLeft = left.head(l);
+        bool hasRight = right.head(r);
+        if (!hasLeft && !hasRight)
+        {
+            return false;
+        }
+        value = (hasLeft && (!hasRight || l < r)) ? l : r;
+        return true;
+    }
+
+    bool contains(const value_type& value) const
+    {
+        return Operation::apply(left.contains(value), right.contains(value));
+    }
+
+    void advance(const value_type& value)
+    {
+        left.advance(value);
+        right.advance(value);
+    }
+
+    size_t bound() const
+    {
+        return Operation::bound(left.bound(), right.bound());
+    }
+
+private:
+    L left;
+    R right;
+};
+
+/**
+ * @brief Множество, хранящее элементы в отсортированном виде без повторов.
+ *        Может быть построено из ленивого выражения над другими множествами
+ *
+ * @tparam T тип элементов множества
+ */
+template<typename T>
+class SortedSet : public SetOperandTag
+{
+public:
+    SortedSet() = default;
+
+    explicit SortedSet(std::vector<T> x)
+        : elements(std::move(x))
+    {
+        normalize(elements);
+    }
+
+    template<typename E>
+    SortedSet(const SetExpression<E>& expression)
+    {
+        assign(expression.self());
+    }
+
+    template<typename E>
+    SortedSet& operator=(const SetExpression<E>& expression)
+    {
+        assign(expression.self());
+        return *this;
+    }
+
+    const std::vector<T>& data() const
+    {
+        return elements;
+    }
+
+private:
+    /**
+     * @brief Вычисление выражения за один проход: на каждом шаге берётся
+     *        наименьший из текущих элементов всех операндов, проверяется его
+     *        принадлежность результату и все операнды сдвигаются за него
+     */
+    template<typename E>
+    void assign(const E& expression)
+    {
+        E tree = expression; // позиции в листьях меняются при вычислении
+        std::vector<T> result;
+        result.reserve(tree.bound());
+
+        T value;
+        while (tree.head(value))
+        {
+            if (tree.contains(value))
+            {
+                result.push_back(value);
+            }
+            tree.advance(value);
+        }
+
+        elements = std::move(result);
+    }
+
+    std::vector<T> elements;
+};
+
+/**
+ * @brief Приведение операнда к выражению: множества оборачиваются в лист,
+ *        выражения остаются как есть
+ */
+template<typename T>
+inline SetReference<T> asExpression(const SortedSet<T>& x)
+{
+    return SetReference<T>(x.data());
+}
+
+template<typename E>
+inline const E& asExpression(const SetExpression<E>& x)
+{
+    return x.self();
+}
+
+template<typename T>
+using SetOperandExpression = std::decay_t<decltype(asExpression(std::declval<const T&>()))>;
+
+template<typename L, typename R>
+using EnableIfSetOperands = std::enable_if_t<std::is_base_of_v<SetOperandTag, L> &&
+                                             std::is_base_of_v<SetOperandTag, R> >;
+
+template<typename L, typename R, typename = EnableIfSetOperands<L, R> >
+inline auto operator|(const L& x, const R& y)
+{
+    return BinarySetExpression<SetOperandExpression<L>, SetOperandExpression<R>, UniteOperation>(
+        asExpression(x), asExpression(y));
+}
+
+template<typename L, typename R, typename = EnableIfSetOperands<L, R> >
+inline auto operator&(const L& x, const R& y)
+{
+    return BinarySetExpression<SetOperandExpression<L>, SetOperandExpression<R>, IntersectOperation>(
+        asExpression(x), asExpression(y));
+}
+
+template<typename L, typename R, typename = EnableIfSetOperands<L, R> >
+inline auto operator-(const L& x, const R& y)
+{
+    return BinarySetExpression<SetOperandExpression<L>, SetOperandExpression<R>, DifferenceOperation>(
+        asExpression(x), asExpression(y));
+}
+
+template<typename L, typename R, typename = EnableIfSetOperands<L, R> >
+inline auto operator^(const L& x, const R& y)
+{
+    return BinarySetExpression<SetOperandExpression<L>, SetOperandExpression<R>,
+                               SymmetricalDifferenceOperation>(asExpression(x), asExpression(y));
+}
+
+/**
+ * @brief Дополнение до универсума: ~x вычисляется как UNIVERSUM - x в том же
+ *        проходе, что и остальное выражение
+ */
+template<typename X, typename = EnableIfSetOperands<X, X> >
+inline auto operator~(const X& x)
+{
+    return BinarySetExpression<SetReference<int>, SetOperandExpression<X>, DifferenceOperation>(
+        SetReference<int>(UNIVERSUM), asExpression(x));
+}
+
+/**
+ * @brief Множество целых чисел, хранимое в виде отсортированного списка
+ *        непересекающихся и несоседних отрезков [l;r]. Операции над такими
+ *        множествами выполняются за O(количество отрезков), поэтому длинные
+ *        сплошные диапазоны и дополнения к широким универсумам не приходится
+ *        хранить поэлементно
+ */
+class IntervalSet
+{
+public:
+    using Interval = std::pair<long long, long long>;
+
+    IntervalSet() = default;
+
+    /**
+     * @brief Построение по массиву элементов (порядок и повторы не важны)
+     *
+     * @param x массив элементов
+     */
+    explicit IntervalSet(std::vector<int> x)
+    {
+        normalize(x);
+        for (int element : x)
+        {
+            if (!intervals.empty() && intervals.back().second + 1 == element)
+            {
+                intervals.back().second = element;
+            }
+            else
+            {
+                intervals.emplace_back(element, element);
+            }
+        }
+    }
+
+    /**
+     * @brief Множество всех целых чисел отрезка [a;b]
+     */
+    static IntervalSet range(long long a, long long b)
+    {
+        IntervalSet result;
+        if (a <= b)
+        {
+            result.intervals.emplace_back(a, b);
+        }
+        return result;
+    }
+
+    const std::vector<Interval>& getIntervals() const
+    {
+        return intervals;
+    }
+
+    /**
+     * @brief Мощность множества
+     */
+    unsigned long long size() const
+    {
+        unsigned long long result = 0;
+        for (const Interval& i : intervals)
+        {
+            result += (unsigned long long)(i.second - i.first) + 1;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Проверка принадлежности элемента множеству, O(log(количество отрезков))
+     */
+    bool contains(long long element) const
+    {
+        auto it = std::upper_bound(intervals.begin(), intervals.end(), element,
+                                   [](long long e, const Interval& i) { return e < i.first; });
+        return it != intervals.begin() && std::prev(it)->second >= element;
+    }
+
+    /**
+     * @brief Перечисление элементов в виде массива
+     *
+     * @return std::vector<int> отсортированные элементы множества
+     */
+    std::vector<int> toVector() const
+    {
+        std::vector<int> result;
+        result.reserve(size());
+        for (const Interval& i : intervals)
+        {
+            for (long long element = i.first; element <= i.second; element++)
+            {
+                result.push_back((int)element);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Поэлементная операция над двумя множествами одним проходом по
+     *        границам отрезков обоих множеств
+     *
+     * @tparam Operation функция (принадлежит x, принадлежит y) -> принадлежит результату
+     */
+    template<typename Operation>
+    static IntervalSet combine(const IntervalSet& x, const IntervalSet& y, Operation operation)
+    {
+        IntervalSet result;
+        const std::vector<Interval>& a = x.intervals;
+        const std::vector<Interval>& b = y.intervals;
+        size_t i = 0, j = 0;
+        bool inA = false, inB = false, inResult = false;
+        long long start = 0;
+
+        // Границы в полуинтервальном виде: отрезок [l;r] - это события l и r + 1
+        while (i < a.size() || j < b.size())
+        {
+            long long nextA = (i < a.size()) ? (inA ? a[i].second + 1 : a[i].first) : 0;
+            long long nextB = (j < b.size()) ? (inB ? b[j].second + 1 : b[j].first) : 0;
+            long long point;
+            if (i < a.size() && (j >= b.size() || nextA <= nextB))
+            {
+                point = nextA;
+            }
+            else
+            {
+                point = nextB;
+            }
+
+            if (i < a.size() && nextA == point)
+            {
+                if (inA)
+                {
+                    i++;
+                }
+                inA = !inA;
+            }
+            if (j < b.size() && nextB == point)
+            {
+                if (inB)
+                {
+                    j++;
+                }
+                inB = !inB;
+            }
+
+            bool now = operation(inA, inB);
+            if (now && !inResult)
+            {
+                start = point;
+            }
+            else if (!now && inResult)
+            {
+                result.append(start, point - 1);
+            }
+            inResult = now;
+        }
+
+        return result;
+    }
+
+private:
+    // Добавление отрезка в конец с объединением соседних отрезков
+    void append(long long l, long long r)
+    {
+        if (!intervals.empty() && intervals.back().second + 1 >= l)
+        {
+            intervals.back().second = std::max(intervals.back().second, r);
+        }
+        else
+        {
+            intervals.emplace_back(l, r);
+        }
+    }
+
+    std::vector<Interval> intervals;
+};
+
+/**
+ * @brief Объединение двух множеств-списков отрезков
+ */
+inline IntervalSet unite(const IntervalSet& x, const IntervalSet& y)
+{
+    return IntervalSet::combine(x, y, [](bool a, bool b) { return a || b; });
+}
+
+/**
+ * @brief Пересечение двух множеств-списков отрезков
+ */
+inline IntervalSet intersect(const IntervalSet& x, const IntervalSet& y)
+{
+    return IntervalSet::combine(x, y, [](bool a, bool b) { return a && b; });
+}
+
+/**
+ * @brief Разность двух множеств-списков отрезков
+ */
+inline IntervalSet difference(const IntervalSet& x, const IntervalSet& y)
+{
+    return IntervalSet::combine(x, y, [](bool a, bool b) { return a && !b; });
+}
+
+/**
+ * @brief Симметричная разность двух множеств-списков отрезков
+ */
+inline IntervalSet symmetricalDifference(const IntervalSet& x, const IntervalSet& y)
+{
+    return IntervalSet::combine(x, y, [](bool a, bool b) { return a != b; });
+}
+
+/**
+ * @brief Дополнение множества x до универсума universum
+ */
+inline IntervalSet complement(const IntervalSet& x, const IntervalSet& universum)
+{
+    return difference(universum, x);
+}
+
+// Универсальное множество в виде списка отрезков
+const IntervalSet UNIVERSUM_INTERVALS = IntervalSet::range(1, 100);
+
+/**
+ * @brief Множество целых чисел, само выбирающее внутреннее представление по
+ *        мощности и разбросу значений:
+ *        - Inline - до INLINE_CAPACITY элементов в массиве внутри объекта;
+ *        - SortedVector - отсортированный массив;
+ *        - Bitmap - битовая карта на отрезке [bitmapBase; bitmapBase + 64 * bits.size());
+ *        - Intervals - список отрезков.
+ *        Из трёх последних выбирается самое компактное. При вставке и
+ *        удалении представление меняется прозрачно для пользователя, бинарные
+ *        операции выбирают ядро по паре представлений операндов
+ */
+class HybridSet
+{
+public:
+    enum class Representation
+    {
+        Inline,
+        SortedVector,
+        Bitmap,
+        Intervals
+    };
+
+    static constexpr size_t INLINE_CAPACITY = 8;
+
+    HybridSet() = default;
+
+    /**
+     * @brief Построение по массиву элементов (порядок и повторы не важны)
+     */
+    explicit HybridSet(std::vector<int> x)
+    {
+        normalize(x);
+        assignSorted(std::move(x));
+    }
+
+    Representation getRepresentation() const
+    {
+        return representation;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool contains(int element) const
+    {
+        switch (representation)
+        {
+        case Representation::Inline:
+            return sortedContains(small.data(), count, element);
+        case Representation::SortedVector:
+            return sortedContains(sorted.data(), sorted.size(), element);
+        case Representation::Bitmap:
+            return testBit(element);
+        case Representation::Intervals:
+            return intervals.contains(element);
+        }
+        return false;
+    }
+
+    /**
+     * @brief Перечисление элементов в порядке возрастания
+     */
+    std::vector<int> toVector() const
+    {
+        switch (representation)
+        {
+        case Representation::Inline:
+            return std::vector<int>(small.begin(), small.begin() + count);
+        case Representation::SortedVector:
+            return sorted;
+        case Representation::Bitmap:
+        {
+            std::vector<int> result;
+            result.reserve(count);
+            for (size_t w = 0; w < bits.size(); w++)
+            {
+                for (uint64_t word = bits[w]; word != 0; word &= word - 1)
+                {
+                    result.push_back((int)(bitmapBase + 64 * (long long)w + lowestBit(word)));
+                }
+            }
+            return result;
+        }
+        case Representation::Intervals:
+            return intervals.toVector();
+        }
+        return {};
+    }
+
+    /**
+     * @brief Добавление элемента. Представление пересматривается, когда
+     *        мощность проходит через степень двойки
+     */
+    void insert(int element)
+    {
+        if (contains(element))
+        {
+            return;
+        }
+
+        switch (representation)
+        {
+        case Representation::Inline:
+            if (count < INLINE_CAPACITY)
+            {
+                auto position = std::upper_bound(small.begin(), small.begin() + count, element);
+                std::copy_backward(position, small.begin() + count, small.begin() + count + 1);
+                *position = element;
+                count++;
+                return;
+            }
+            sorted.assign(small.begin(), small.begin() + count);
+            representation = Representation::SortedVector;
+            // fall through
+        case Representation::SortedVector:
+            sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), element), element);
+            break;
+        case Representation::Bitmap:
+            if (element < bitmapBase || element >= bitmapBase + 64 * (long long)bits.size())
+            {
+                std::vector<int> elements = toVector();
+                elements.insert(std::upper_bound(elements.begin(), elements.end(), element), element);
+                assignSorted(std::move(elements));
+                return;
+            }
+            bits[(size_t)((element - bitmapBase) / 64)] |= uint64_t(1) << ((element - bitmapBase) % 64);
+            break;
+        case Representation::Intervals:
+            intervals = unite(intervals, IntervalSet::range(element, element));
+            break;
+        }
+
+        count++;
+        if ((count & (count - 1)) == 0)
+        {
+            assignSorted(toVector());
+        }
+    }
+
+    /**
+     * @brief Удаление элемента
+     */
+    void erase(int element)
+    {
+        if (!contains(element))
+        {
+            return;
+        }
+
+        switch (representation)
+        {
+        case Representation::Inline:
+        {
+            auto position = std::lower_bound(small.begin(), small.begin() + count, element);
+            std::copy(position + 1, small.begin() + count, position);
+            break;
+        }
+        case Representation::SortedVector:
+            sorted.erase(std::lower_bound(sorted.begin(), sorted.end(), element));
+            break;
+        case Representation::Bitmap:
+            bits[(size_t)((element - bitmapBase) / 64)] &= ~(uint64_t(1) << ((element - bitmapBase) % 64));
+            break;
+        case Representation::Intervals:
+            intervals = difference(intervals, IntervalSet::range(element, element));
+            break;
+        }
+
+        count--;
+        if (representation != Representation::Inline && (count & (count - 1)) == 0)
+        {
+            assignSorted(toVector());
+        }
+    }
+
+    friend HybridSet unite(const HybridSet& x, const HybridSet& y);
+    friend HybridSet intersect(const HybridSet& x, const HybridSet& y);
+    friend HybridSet difference(const HybridSet& x, const HybridSet& y);
+    friend HybridSet symmetricalDifference(const HybridSet& x, const HybridSet& y);
+
+    /**
+     * @brief Бинарная операция с выбором ядра по представлениям операндов:
+     *        две битовые карты - пословные операции, два списка отрезков -
+     *        проход по границам, маленький левый операнд при пересечении или
+     *        разности - поиск его элементов во втором, иначе - слияние
+     *        отсортированных последовательностей
+     */
+    template<typename Operation>
+    static HybridSet combine(const HybridSet& x, const HybridSet& y, Operation operation, bool probeLeft)
+    {
+        if (x.representation == Representation::Bitmap && y.representation == Representation::Bitmap)
+        {
+            return combineBitmaps(x, y, operation);
+        }
+        if (x.representation == Representation::Intervals && y.representation == Representation::Intervals)
+        {
+            HybridSet result;
+            result.assignIntervals(IntervalSet::combine(x.intervals, y.intervals, operation));
+            return result;
+        }
+        if (probeLeft && x.size() * 16 < y.size())
+        {
+            std::vector<int> result;
+            for (int element : x.toVector())
+            {
+                if (operation(true, y.contains(element)))
+                {
+                    result.push_back(element);
+                }
+            }
+            HybridSet set;
+            set.assignSorted(std::move(result));
+            return set;
+        }
+
+        std::vector<int> a = x.toVector(), b = y.toVector(), result;
+        result.reserve(a.size() + b.size());
+        size_t i = 0, j = 0;
+        while (i < a.size() || j < b.size())
+        {
+            bool inA = i < a.size() && (j >= b.size() || a[i] <= b[j]);
+            bool inB = j < b.size() && (i >= a.size() || b[j] <= a[i]);
+            int element = inA ? a[i] : b[j];
+            if (operation(inA, inB))
+            {
+                result.push_back(element);
+            }
+            i += inA ? 1 : 0;
+            j += inB ? 1 : 0;
+        }
+        HybridSet set;
+        set.assignSorted(std::move(result));
+        return set;
+    }
+
+private:
+    Representation representation = Representation::Inline;
+    size_t count = 0;
+    std::array<int, INLINE_CAPACITY> small{};
+    std::vector<int> sorted;
+    long long bitmapBase = 0;
+    std::vector<uint64_t> bits;
+    IntervalSet intervals;
+
+    // Номер младшего единичного бита (word != 0) и число единиц - одной
+    // инструкцией процессора
+    static int lowestBit(uint64_t word)
+    {
+        return __builtin_ctzll(word);
+    }
+
+    static size_t popCount(uint64_t word)
+    {
+        return (size_t)__builtin_popcountll(word);
+    }
+
+    bool testBit(long long element) const
+    {
+        if (element < bitmapBase || element >= bitmapBase + 64 * (long long)bits.size())
+        {
+            return false;
+        }
+        return (bits[(size_t)((element - bitmapBase) / 64)] >> ((element - bitmapBase) % 64)) & 1;
+    }
+
+    // Выравнивание начала битовой карты на границу слова
+    static long long alignDown(long long value)
+    {
+        return (value >= 0) ? value / 64 * 64 : -((-value + 63) / 64 * 64);
+    }
+
+    void clear()
+    {
+        count = 0;
+        sorted.clear();
+        bits.clear();
+        intervals = IntervalSet();
+    }
+
+    /**
+     * @brief Выбор представления для отсортированного массива без повторов:
+     *        самое компактное из отсортированного массива (4 байта на элемент),
+     *        битовой карты (1 бит на значение разброса) и списка отрезков
+     *        (16 байт на отрезок)
+     */
+    void assignSorted(std::vector<int> elements)
+    {
+        clear();
+        count = elements.size();
+
+        if (count <= INLINE_CAPACITY)
+        {
+            representation = Representation::Inline;
+            std::copy(elements.begin(), elements.end(), small.begin());
+            return;
+        }
+
+        size_t runs = 1;
+        for (size_t i = 1; i < elements.size(); i++)
+        {
+            runs += (elements[i] != elements[i - 1] + 1) ? 1 : 0;
+        }
+        long long base = alignDown(elements.front());
+        unsigned long long span = (unsigned long long)((long long)elements.back() - base) + 1;
+
+        unsigned long long vectorBytes = 4ULL * count;
+        unsigned long long bitmapBytes = (span + 63) / 64 * 8;
+        unsigned long long intervalBytes = 16ULL * runs;
+
+        if (intervalBytes <= vectorBytes && intervalBytes <= bitmapBytes)
+        {
+            representation = Representation::Intervals;
+            intervals = IntervalSet(std::move(elements));
+        }
+        else if (bitmapBytes < vectorBytes)
+        {
+            representation = Representation::Bitmap;
+            bitmapBase = base;
+            bits.assign((size_t)((span + 63) / 64), 0);
+            for (int element : elements)
+            {
+                bits[(size_t)((element - base) / 64)] |= uint64_t(1) << ((element - base) % 64);
+            }
+        }
+        else
+        {
+            representation = Representation::SortedVector;
+            sorted = std::move(elements);
+        }
+    }
+
+    void assignIntervals(IntervalSet x)
+    {
+        clear();
+        count = (size_t)x.size();
+        size_t runs = x.getIntervals().size();
+        if (count > INLINE_CAPACITY && 16 * runs <= 4 * count)
+        {
+            representation = Representation::Intervals;
+            intervals = std::move(x);
+        }
+        else
+        {
+            assignSorted(x.toVector());
+        }
+    }
+
+    template<typename Operation>
+    static HybridSet combineBitmaps(const HybridSet& x, const HybridSet& y, Operation operation)
+    {
+        long long base = std::min(x.bitmapBase, y.bitmapBase);
+        long long end = std::max(x.bitmapBase + 64 * (long long)x.bits.size(),
+                                 y.bitmapBase + 64 * (long long)y.bits.size());
+        auto word = [](const HybridSet& s, long long position) -> uint64_t
+        {
+            long long index = (position - s.bitmapBase) / 64;
+            return (position < s.bitmapBase || index >= (long long)s.bits.size()) ? 0 : s.bits[(size_t)index];
+        };
+
+        HybridSet result;
+        result.representation = Representation::Bitmap;
+        result.bitmapBase = base;
+        result.bits.resize((size_t)((end - base) / 64));
+        for (size_t w = 0; w < result.bits.size(); w++)
+        {
+            uint64_t a = word(x, base + 64 * (long long)w), b = word(y, base + 64 * (long long)w);
+            // Операция над признаками применяется ко всем 64 битам сразу
+            uint64_t value = (operation(true, true) ? (a & b) : 0) |
+                             (operation(true, false) ? (a & ~b) : 0) |
+                             (operation(false, true) ? (~a & b) : 0);
+            result.bits[w] = value;
+            result.count += popCount(value);
+        }
+
+        if (result.count <= INLINE_CAPACITY || result.bits.size() * 8 > 4 * result.count)
+        {
+            result.assignSorted(result.toVector());
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Объединение двух гибридных множеств
  */
-template<typename T>
-inline bool found(const std::vector<T>& x, const T& element)
+inline HybridSet unite(const HybridSet& x, const HybridSet& y)
 {
-    return std::find(x.begin(), x.end(), element) != x.end();
+    return HybridSet::combine(x, y, [](bool a, bool b) { return a || b; }, false);
 }
 
 /**
- * @brief Задание универсального множества. В данном случае - целые числа
- *        диапазона [1;100]
- *
- * @return std::vector<int> универсальное множество
+ * @brief Пересечение двух гибридных множеств
  */
-std::vector<int> generateUniversum()
+inline HybridSet intersect(const HybridSet& x, const HybridSet& y)
 {
-    std::vector<int> universum(100);
-    for (int i = 0; i < 100; i++)
+    if (x.size() > y.size())
     {
-        universum[i] = i + 1;
+        return HybridSet::combine(y, x, [](bool a, bool b) { return a && b; }, true);
     }
-    return universum;
+    return HybridSet::combine(x, y, [](bool a, bool b) { return a && b; }, true);
 }
 
-// Универсальное множество
-const std::vector<int> UNIVERSUM = generateUniversum();
-
 /**
- * @brief Ввод множества
- * 
- * @param name имя вводимого множества
- * @return std::vector<int> введенное множество
+ * @brief Разность двух гибридных множеств
  */
-std::vector<int> inputSet(const std::string& name)
+inline HybridSet difference(const HybridSet& x, const HybridSet& y)
 {
-    // Ввод множества <name>
-    std::cout << "Введите мощность множества " << name << " (не забывайте, "
-                 "элементы введенного множества при их повторении будет прои"
-                 "гнорированы и мощность множества будет уменьшена): ";
-    size_t size;
-    std::cin >> size;
-
-    std::vector<int> x(size); // создаем множество
-
-    bool badSet = false;
-    do { // Вводим до тех пор, пока не будет введено множество, соответствующее требованиям
-        badSet = false;
-
-        std::cout << "Введите множество " << name << ("ограничение по вводимым числам - "
-                      "целые числа от 1 до 100): ");
-        for (size_t i = 0; i < size; i++)
-        {
-            std::cin >> x[i];
-            if (x[i] < 1 || x[i] > 100) // проверка введенного элемента
-            {
-                badSet = true;
-                std::cout << i + 1 << ("-ый (-ий/-ой) элемент множества"
-                                       " не соответствует нужному диапазону значений!\n");
-            }
-        }
-    } while (badSet);
-
-    return x;
+    return HybridSet::combine(x, y, [](bool a, bool b) { return a && !b; }, true);
 }
 
 /**
- * @brief Печатает массив на консоль
- * 
- * @tparam T тип элементов в массиве
- * @param s массив
+ * @brief Симметричная разность двух гибридных множеств
  */
-template<typename T>
-void printArray(const std::vector<T>& s)
+inline HybridSet symmetricalDifference(const HybridSet& x, const HybridSet& y)
 {
-    std::cout << "{ ";
-    for (size_t i = 0; i < s.size(); i++)
-    {
-       std::cout << s[i] << ((i + 1 != s.size()) ? ", " : " ");
-    }
-    std::cout << "}\n";
+    return HybridSet::combine(x, y, [](bool a, bool b) { return a != b; }, false);
 }
 
 /**
@@ -119,6 +1661,7 @@ void printArray(const std::vector<T>& s)
 template<typename T>
 std::vector<T> unite(const std::vector<T>& x, const std::vector<T>& y)
 {
+    OperationTimer timer("unite", x.size() + y.size());
     std::vector<T> result = x; // добавляем все элементы из мн-ва x
     // Добавляем все эл-ты их мн-ва y
     for (size_t i = 0; i < y.size(); i++)
@@ -142,6 +1685,7 @@ std::vector<T> unite(const std::vector<T>& x, const std::vector<T>& y)
 template<typename T>
 std::vector<T> intersect(const std::vector<T>& x, const std::vector<T>& y)
 {
+    OperationTimer timer("intersect", x.size() + y.size());
     std::vector<T> result;
     for (size_t i = 0; i < x.size(); i++)
     {
@@ -166,6 +1710,7 @@ std::vector<T> intersect(const std::vector<T>& x, const std::vector<T>& y)
 template<typename T>
 std::vector<T> difference(const std::vector<T>& x, const std::vector<T>& y)
 {
+    OperationTimer timer("difference", x.size() + y.size());
     // Реализация аналогична реализации алгоритма пересечения
     std::vector<T> result;
     
@@ -193,15 +1738,266 @@ template<typename T>
 std::vector<T> symmetricalDifference(const std::vector<T>& x,
                                      const std::vector<T>& y)
 {
-    std::vector<T> xyDifference = difference(x, y);
-    std::vector<T> yxDifference = difference(y, x);
-    
-    std::vector<T> result = unite(xyDifference, yxDifference);
+    OperationTimer timer("symmetricalDifference", x.size() + y.size());
+    // Один проход по отсортированным копиям вместо двух разностей и объединения
+    SortedSet<T> result = SortedSet<T>(x) ^ SortedSet<T>(y);
+    return result.data();
+}
+
+// Начиная с этого числа множеств uniteAll/intersectAll работают в несколько потоков
+const size_t PARALLEL_SETS_THRESHOLD = 256;
+
+/**
+ * @brief k-путевое слияние отсортированных множеств без повторов с помощью
+ *        кучи: из кучи извлекается наименьший текущий элемент, повторы
+ *        пропускаются
+ *
+ * @tparam T тип элементов множества
+ * @param sets отсортированные множества без повторов
+ * @param begin индекс первого сливаемого множества
+ * @param end индекс за последним сливаемым множеством
+ * @return std::vector<T> объединение множеств sets[begin..end)
+ */
+template<typename T>
+std::vector<T> mergeSortedSets(const std::vector< std::vector<T> >& sets, size_t begin, size_t end)
+{
+    // Элемент кучи: (значение, номер множества, позиция в нём)
+    using Cursor = std::tuple<T, size_t, size_t>;
+    std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor> > heap;
+
+    size_t total = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        if (!sets[i].empty())
+        {
+            heap.emplace(sets[i][0], i, 0);
+            total += sets[i].size();
+        }
+    }
+
+    std::vector<T> result;
+    result.reserve(total);
+    while (!heap.empty())
+    {
+        Cursor top = heap.top();
+        heap.pop();
+        const T& value = std::get<0>(top);
+        if (result.empty() || result.back() != value)
+        {
+            result.push_back(value);
+        }
+
+        size_t set = std::get<1>(top), position = std::get<2>(top) + 1;
+        if (position < sets[set].size())
+        {
+            heap.emplace(sets[set][position], set, position);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Пересечение отсортированных множеств без повторов, начиная с самых
+ *        маленьких: каждый следующий элемент ищется двоичным поиском с
+ *        последней найденной позиции, при пустом промежуточном результате
+ *        работа прекращается
+ *
+ * @tparam T тип элементов множества
+ * @param first самое маленькое множество
+ * @param sets отсортированные множества без повторов, упорядоченные по возрастанию мощности
+ * @param begin индекс первого множества
+ * @param end индекс за последним множеством
+ * @return std::vector<T> пересечение множества first и множеств sets[begin..end)
+ */
+template<typename T>
+std::vector<T> intersectSortedSets(const std::vector<T>& first, const std::vector< std::vector<T> >& sets,
+                                   size_t begin, size_t end)
+{
+    std::vector<T> result = first;
+    for (size_t i = begin; i < end && !result.empty(); i++)
+    {
+        const std::vector<T>& other = sets[i];
+        size_t from = 0;
+        size_t kept = 0;
+        for (const T& element : result)
+        {
+            from = gallopingLowerBound(other.data(), from, other.size(), element);
+            if (from == other.size())
+            {
+                break;
+            }
+            if (other[from] == element)
+            {
+                result[kept++] = element;
+            }
+        }
+        result.resize(kept);
+    }
 
-    normalize(result);
     return result;
 }
 
+/**
+ * @brief Параллельная попарная редукция: части разбиваются на пары, пары
+ *        сводятся одновременно в разных потоках, пока не останется одна часть
+ *
+ * @tparam T тип элементов множества
+ * @tparam Reduce функция (множество, множество) -> множество
+ * @param parts части
+ * @param reduce функция сведения двух частей
+ * @return std::vector<T> результат редукции
+ */
+template<typename T, typename Reduce>
+std::vector<T> parallelTreeReduce(std::vector< std::vector<T> > parts, Reduce reduce)
+{
+    if (parts.empty())
+    {
+        return {};
+    }
+
+    while (parts.size() > 1)
+    {
+        std::vector< std::vector<T> > next((parts.size() + 1) / 2);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i + 1 < parts.size(); i += 2)
+        {
+            workers.emplace_back([&parts, &next, &reduce, i]()
+            {
+                OperationTimer timer("parallelTreeReduce", parts[i].size() + parts[i + 1].size());
+                next[i / 2] = reduce(parts[i], parts[i + 1]);
+            });
+        }
+        if (parts.size() % 2 == 1)
+        {
+            next.back() = std::move(parts.back());
+        }
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+        parts = std::move(next);
+    }
+
+    return std::move(parts.front());
+}
+
+/**
+ * @brief Разбиение [0; n) на отрезки для потоков и применение к ним функции
+ *        в параллельных потоках
+ *
+ * @tparam T тип элементов множества
+ * @tparam Chunk функция (начало, конец) -> множество
+ * @param n количество множеств
+ * @param chunk функция обработки отрезка
+ * @return std::vector< std::vector<T> > результаты по отрезкам
+ */
+template<typename T, typename Chunk>
+std::vector< std::vector<T> > processInChunks(size_t n, Chunk chunk)
+{
+    size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    size_t chunkSize = (n + threads - 1) / threads;
+
+    std::vector< std::vector<T> > parts((n + chunkSize - 1) / chunkSize);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        workers.emplace_back([&parts, &chunk, i, chunkSize, n]()
+        {
+            OperationTimer timer("processInChunks", std::min(n, (i + 1) * chunkSize) - i * chunkSize);
+            parts[i] = chunk(i * chunkSize, std::min(n, (i + 1) * chunkSize));
+        });
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    return parts;
+}
+
+/**
+ * @brief Объединение произвольного числа множеств. Каждое множество
+ *        сортируется один раз, затем все они сливаются k-путевым слиянием;
+ *        при большом числе множеств группы сливаются в разных потоках и
+ *        результаты сводятся параллельной попарной редукцией
+ *
+ * @tparam T тип элементов множества
+ * @param sets множества
+ * @return std::vector<T> мн-во, являющееся объединением всех множеств
+ */
+template<typename T>
+std::vector<T> uniteAll(std::vector< std::vector<T> > sets)
+{
+    OperationTimer timer("uniteAll", sets.size());
+    for (std::vector<T>& x : sets)
+    {
+        normalize(x);
+    }
+
+    if (sets.size() < PARALLEL_SETS_THRESHOLD)
+    {
+        return mergeSortedSets(sets, 0, sets.size());
+    }
+
+    std::vector< std::vector<T> > parts = processInChunks<T>(sets.size(), [&sets](size_t begin, size_t end)
+    {
+        return mergeSortedSets(sets, begin, end);
+    });
+    return parallelTreeReduce(std::move(parts), [](const std::vector<T>& x, const std::vector<T>& y)
+    {
+        std::vector<T> result;
+        result.reserve(x.size() + y.size());
+        std::set_union(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result));
+        return result;
+    });
+}
+
+/**
+ * @brief Пересечение произвольного числа множеств. Множества обрабатываются
+ *        от меньших к большим, пустой промежуточный результат завершает
+ *        работу досрочно; при большом числе множеств группы пересекаются в
+ *        разных потоках
+ *
+ * @tparam T тип элементов множества
+ * @param sets множества
+ * @return std::vector<T> мн-во, являющееся пересечением всех множеств
+ */
+template<typename T>
+std::vector<T> intersectAll(std::vector< std::vector<T> > sets)
+{
+    OperationTimer timer("intersectAll", sets.size());
+    if (sets.empty())
+    {
+        return {};
+    }
+    for (std::vector<T>& x : sets)
+    {
+        normalize(x);
+    }
+    std::sort(sets.begin(), sets.end(), [](const std::vector<T>& x, const std::vector<T>& y)
+    {
+        return x.size() < y.size();
+    });
+
+    if (sets.size() < PARALLEL_SETS_THRESHOLD)
+    {
+        return intersectSortedSets(sets.front(), sets, 1, sets.size());
+    }
+
+    // Каждая группа начинает с самого маленького множества, чтобы быстро сужаться
+    std::vector< std::vector<T> > parts = processInChunks<T>(sets.size() - 1, [&sets](size_t begin, size_t end)
+    {
+        return intersectSortedSets(sets.front(), sets, begin + 1, end + 1);
+    });
+    return parallelTreeReduce(std::move(parts), [](const std::vector<T>& x, const std::vector<T>& y)
+    {
+        std::vector<T> result;
+        std::set_intersection(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result));
+        return result;
+    });
+}
+
 /**
  * @brief Дополнение множества x к универсуму
  *
@@ -212,31 +2008,199 @@ std::vector<T> symmetricalDifference(const std::vector<T>& x,
 template<typename T>
 inline std::vector<T> additionToTheUniversum(const std::vector<T>& x)
 {
-    std::vector<T> result = difference(UNIVERSUM, x);
-    
-    normalize(result);
-    return result;
+    OperationTimer timer("additionToTheUniversum", x.size());
+    // Дополнение состоит из нескольких длинных отрезков, поэтому вычисляется
+    // над списками отрезков
+    IntervalSet complementIntervals = complement(IntervalSet(std::vector<int>(x.begin(), x.end())),
+                                                 UNIVERSUM_INTERVALS);
+    return complementIntervals.toVector();
 }
 
-int main()
+/**
+ * @brief Сеанс работы с парой множеств X и Y. Результаты всех операций
+ *        (объединение, пересечение, обе разности, симметрическая разность и
+ *        дополнения) хранятся готовыми и поддерживаются при вставке и
+ *        удалении отдельных элементов за O(log n), без пересчёта с нуля
+ */
+class SetSession
+{
+public:
+    enum Result
+    {
+        UNION,
+        INTERSECTION,
+        X_MINUS_Y,
+        Y_MINUS_X,
+        SYMMETRICAL_DIFFERENCE,
+        X_COMPLEMENT,
+        Y_COMPLEMENT,
+        RESULT_COUNT
+    };
+
+    /**
+     * @brief Начальные результаты вычисляются ленивыми выражениями над
+     *        отсортированными копиями X и Y - по одному проходу на результат
+     */
+    SetSession(const std::vector<int>& x, const std::vector<int>& y)
+    {
+        OperationTimer timer("SetSession", x.size() + y.size());
+        SortedSet<int> sortedX(x), sortedY(y);
+        assign(UNION, sortedX | sortedY);
+        assign(INTERSECTION, sortedX & sortedY);
+        assign(X_MINUS_Y, sortedX - sortedY);
+        assign(Y_MINUS_X, sortedY - sortedX);
+        assign(SYMMETRICAL_DIFFERENCE, sortedX ^ sortedY);
+        assign(X_COMPLEMENT, ~sortedX);
+        assign(Y_COMPLEMENT, ~sortedY);
+
+        sets[0] = HybridSet(sortedX.data());
+        sets[1] = HybridSet(sortedY.data());
+    }
+
+    std::vector<int> getX() const
+    {
+        return sets[0].toVector();
+    }
+
+    std::vector<int> getY() const
+    {
+        return sets[1].toVector();
+    }
+
+    const std::set<int>& get(Result result) const
+    {
+        return results[result];
+    }
+
+    /**
+     * @brief Добавление элемента в множество X (toX = true) или Y
+     */
+    void insert(bool toX, int element)
+    {
+        OperationTimer timer("SetSession::insert", 1);
+        update(toX, element, true);
+    }
+
+    /**
+     * @brief Удаление элемента из множества X (fromX = true) или Y
+     */
+    void erase(bool fromX, int element)
+    {
+        OperationTimer timer("SetSession::erase", 1);
+        update(fromX, element, false);
+    }
+
+private:
+    HybridSet sets[2]; // представление X и Y подстраивается под их плотность
+    std::set<int> results[RESULT_COUNT];
+
+    template<typename E>
+    void assign(Result result, const SetExpression<E>& expression)
+    {
+        SortedSet<int> value = expression;
+        results[result] = std::set<int>(value.data().begin(), value.data().end());
+    }
+
+    /**
+     * @brief Принадлежность элемента результату по его принадлежности X, Y и универсуму
+     */
+    static bool belongs(Result result, bool inX, bool inY, bool inUniversum)
+    {
+        switch (result)
+        {
+        case UNION:
+            return inX || inY;
+        case INTERSECTION:
+            return inX && inY;
+        case X_MINUS_Y:
+            return inX && !inY;
+        case Y_MINUS_X:
+            return inY && !inX;
+        case SYMMETRICAL_DIFFERENCE:
+            return inX != inY;
+        case X_COMPLEMENT:
+            return inUniversum && !inX;
+        case Y_COMPLEMENT:
+            return inUniversum && !inY;
+        default:
+            return false;
+        }
+    }
+
+    void update(bool isX, int element, bool present)
+    {
+        HybridSet& target = sets[isX ? 0 : 1];
+        if (target.contains(element) == present)
+        {
+            return;
+        }
+
+        bool inUniversum = (element >= UNIVERSUM.front() && element <= UNIVERSUM.back());
+        bool oldX = sets[0].contains(element), oldY = sets[1].contains(element);
+        if (present)
+        {
+            target.insert(element);
+        }
+        else
+        {
+            target.erase(element);
+        }
+        bool newX = sets[0].contains(element), newY = sets[1].contains(element);
+
+        // Меняются только те результаты, принадлежность которым изменилась
+        for (int r = 0; r < RESULT_COUNT; r++)
+        {
+            bool before = belongs((Result)r, oldX, oldY, inUniversum);
+            bool after = belongs((Result)r, newX, newY, inUniversum);
+            if (before && !after)
+            {
+                results[r].erase(element);
+            }
+            else if (!before && after)
+            {
+                results[r].insert(element);
+            }
+        }
+    }
+};
+
+int main(int argc, char* argv[])
 {
     std::setlocale(LC_ALL, "rus");
 
+    // --stats - вывод статистики выполнения операций в stderr при выходе,
+    // --trace=файл - запись трассировки операций в файл при выходе
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--stats") == 0)
+        {
+            Statistics::enable();
+        }
+        else if (std::strncmp(argv[i], "--trace=", 8) == 0)
+        {
+            Trace::enable(argv[i] + 8);
+        }
+    }
+
     // Ввод множества X
     std::vector<int> x = inputSet("X");
 
     // Ввод множества Y
     std::vector<int> y = inputSet("Y");
-    
+
+    // Результаты операций поддерживаются при изменении множеств
+    SetSession session(x, y);
+
     bool terminated = false;
     while (true)
     {
         // Выбор операции:
         std::cout << ("Выберите операцию которую вы хотите провести с множеством"
-                      " (число от 1 до 5):\nОбъединение (1);\nПересечение (2);\n"
+                      " (число от 1 до 7):\nОбъединение (1);\nПересечение (2);\n"
                       "Разность (3);\nСимметрическая разность (4);\nДополнение к"
-                      " универсуму (5);\nПрервать выполнение программы - любое"
-                      " другое число.\n");
+                      " универсуму (5);\nДобавить элемент в множество (6);\n"
+                      "Удалить элемент из множества (7);\nПрервать выполнение "
+                      "программы - любое другое число.\n");
         int operation;
         std::cin >> operation;
 
@@ -244,33 +2208,63 @@ int main()
         {
         case 1: // Объединение
             std::cout << "Объединение множеств X и Y: ";
-            printArray(unite(x, y));
+            printArray(session.get(SetSession::UNION));
             std::cout << "\n";
             break;
         case 2: // Пересечение
             std::cout << "Пересечение множеств X и Y: ";
-            printArray(intersect(x, y));
+            printArray(session.get(SetSession::INTERSECTION));
             std::cout << "\n";
             break;
         case 3: // Разность X\Y и Y\X
             std::cout << "Разность множеств X и Y: ";
-            printArray(difference(x, y));
+            printArray(session.get(SetSession::X_MINUS_Y));
             std::cout << "Разность множеств Y и X: ";
-            printArray(difference(y, x));
+            printArray(session.get(SetSession::Y_MINUS_X));
             std::cout << "\n";
             break;
         case 4: // Симметрическая разность X и Y
             std::cout << "Симметрическая разность множеств X и Y: ";
-            printArray(symmetricalDifference(x, y));
+            printArray(session.get(SetSession::SYMMETRICAL_DIFFERENCE));
             std::cout << "\n";
             break;
         case 5: // Дополнение до универсума множества X и множества Y
             std::cout << "Дополнение до универсума множества X: ";
-            printArray(additionToTheUniversum(x));
+            printArray(session.get(SetSession::X_COMPLEMENT));
             std::cout << "Дополнение до универсума множества Y: ";
-            printArray(additionToTheUniversum(y));
+            printArray(session.get(SetSession::Y_COMPLEMENT));
+            std::cout << "\n";
+            break;
+        case 6: // Добавление элемента
+        case 7: // Удаление элемента
+        {
+            std::string name;
+            do
+            {
+                std::cout << "Введите имя множества (X или Y): ";
+                std::cin >> name;
+            } while (name != "X" && name != "Y");
+
+            int element;
+            do
+            {
+                std::cout << "Введите элемент (целое число от 1 до 100): ";
+                std::cin >> element;
+            } while (element < 1 || element > 100);
+
+            if (operation == 6)
+            {
+                session.insert(name == "X", element);
+            }
+            else
+            {
+                session.erase(name == "X", element);
+            }
+            std::cout << "Множество " << name << ": ";
+            printArray(name == "X" ? session.getX() : session.getY());
             std::cout << "\n";
             break;
+        }
         default:
             std::cout << "Выполнение программы завершено!\n";
             terminated = true;
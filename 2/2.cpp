@@ -4,6 +4,608 @@
 #include <vector> // std::vector
 #include <utility> // std::pair
 #include <string> // std::string
+#include <algorithm> // std::find, std::any_of
+#include <cstdlib> // std::malloc, std::free, std::atexit
+#include <cstring> // std::strcmp, std::strncmp
+#include <fstream> // std::ofstream
+#include <memory> // std::unique_ptr, std::make_unique
+#include <map> // std::map
+#include <atomic> // std::atomic
+#include <mutex> // std::mutex, std::lock_guard, std::call_once
+#include <chrono> // std::chrono::steady_clock
+#include <new> // std::bad_alloc
+#include <iomanip> // std::setw
+#include <thread> // std::thread, std::this_thread::yield
+#include <optional> // std::optional
+#include <set> // std::set
+#include <cmath> // HUGE_VAL
+#include <cstdint> // uint64_t
+#include <numeric> // std::iota
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // _mm_cmplt_epi32, _mm_cmpgt_epi32
+#endif
+
+// Векторный поиск с выбором реализации во время выполнения (GCC и Clang на x86)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_MEMBERSHIP 1
+#include <immintrin.h> // _mm256_cmpeq_epi32, _mm_cmpeq_epi64
+#else
+#define SIMD_MEMBERSHIP 0
+#endif
+
+/**
+ * @brief Сбор статистики выполнения операций (ключ --stats): число вызовов,
+ *        время, обработанные элементы, сравнения и выделения памяти по
+ *        каждой операции. Итоговая таблица выводится в stderr при выходе.
+ *        Пока сбор выключен, замер стоит одной проверки флага
+ */
+class Statistics
+{
+public:
+	struct Counters
+	{
+		size_t calls = 0;
+		long long nanoseconds = 0;
+		size_t elements = 0;
+		size_t probes = 0;
+		size_t allocations = 0;
+		size_t allocatedBytes = 0;
+	};
+	
+	static bool isEnabled()
+	{
+		return enabled;
+	}
+	
+	/**
+	 * @brief Включение сбора статистики и вывода таблицы при выходе из программы
+	 */
+	static void enable()
+	{
+		state(); // таблица должна быть создана до регистрации std::atexit
+		enabled = true;
+		std::call_once(registered, []()
+		{
+			std::atexit(print);
+		});
+	}
+	
+	/**
+	 * @brief Учёт n сравнений (проверок принадлежности)
+	 */
+	static void countProbes(size_t n)
+	{
+		if (enabled)
+		{
+			probes.fetch_add(n, std::memory_order_relaxed);
+		}
+	}
+	
+	/**
+	 * @brief Учёт выделения памяти (вызывается из operator new)
+	 */
+	static void countAllocation(size_t bytes)
+	{
+		if (enabled)
+		{
+			allocations.fetch_add(1, std::memory_order_relaxed);
+			allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+		}
+	}
+	
+	/**
+	 * @brief Текущие значения счётчиков сравнений и выделений памяти
+	 */
+	static Counters snapshot()
+	{
+		Counters result;
+		result.probes = probes.load(std::memory_order_relaxed);
+		result.allocations = allocations.load(std::memory_order_relaxed);
+		result.allocatedBytes = allocatedBytes.load(std::memory_order_relaxed);
+		return result;
+	}
+	
+	static void record(const char* operation, const Counters& delta)
+	{
+		State& s = state();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		Counters& total = s.table[operation];
+		total.calls += delta.calls;
+		total.nanoseconds += delta.nanoseconds;
+		total.elements += delta.elements;
+		total.probes += delta.probes;
+		total.allocations += delta.allocations;
+		total.allocatedBytes += delta.allocatedBytes;
+	}
+
+private:
+	struct State
+	{
+		std::mutex mutex;
+		std::map<std::string, Counters> table;
+	};
+	
+	static inline std::atomic<bool> enabled{false}; // читается из рабочих потоков
+	static inline std::once_flag registered; // повторный ключ не регистрирует вывод снова
+	static inline std::atomic<size_t> probes{0};
+	static inline std::atomic<size_t> allocations{0};
+	static inline std::atomic<size_t> allocatedBytes{0};
+	
+	static State& state()
+	{
+		static State s;
+		return s;
+	}
+	
+	static void print()
+	{
+		enabled = false;
+		State& s = state();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		// Заголовок выровнен заранее: std::setw считает байты, а не символы кириллицы
+		std::cerr << "\nСтатистика операций:\n"
+		             "операция                   вызовов    время, мкс   элементов   сравнений   выделений          байт\n";
+		for (const auto& entry : s.table)
+		{
+			const Counters& c = entry.second;
+			std::cerr << std::left << std::setw(24) << entry.first << std::right
+			          << std::setw(10) << c.calls << std::setw(14) << c.nanoseconds / 1000
+			          << std::setw(12) << c.elements << std::setw(12) << c.probes
+			          << std::setw(12) << c.allocations << std::setw(14) << c.allocatedBytes << "\n";
+		}
+	}
+};
+
+/**
+ * @brief Трассировка операций (ключ --trace=файл) в формате Chrome trace
+ *        events (chrome://tracing, Perfetto): каждая операция - отрезок
+ *        времени с номером потока, вложенные операции видны как вложенные
+ *        отрезки. События пишутся в буфер своего потока без блокировок,
+ *        файл записывается при выходе из программы
+ */
+class Trace
+{
+public:
+	static bool isEnabled()
+	{
+		return enabled;
+	}
+	
+	/**
+	 * @brief Включение трассировки с записью в файл path при выходе из программы
+	 */
+	static void enable(const std::string& path)
+	{
+		state().path = path; // состояние должно быть создано до регистрации std::atexit
+		origin = std::chrono::steady_clock::now();
+		enabled = true;
+		std::call_once(registered, []()
+		{
+			std::atexit(write);
+		});
+	}
+	
+	static void record(const char* operation, std::chrono::steady_clock::time_point start,
+	                   std::chrono::steady_clock::time_point finish)
+	{
+		threadBuffer().events.push_back({operation, nanoseconds(start - origin), nanoseconds(finish - start)});
+	}
+
+private:
+	struct Event
+	{
+		const char* operation;
+		long long start;
+		long long duration;
+	};
+	
+	struct Buffer
+	{
+		size_t thread = 0;
+		std::vector<Event> events;
+	};
+	
+	struct State
+	{
+		std::mutex mutex;
+		std::string path;
+		std::vector< std::unique_ptr<Buffer> > buffers;
+	};
+	
+	static inline std::atomic<bool> enabled{false};
+	static inline std::once_flag registered;
+	static inline std::chrono::steady_clock::time_point origin;
+	
+	static State& state()
+	{
+		static State s;
+		return s;
+	}
+	
+	static long long nanoseconds(std::chrono::steady_clock::duration d)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+	}
+	
+	// Буфер потока регистрируется один раз, дальше события пишутся без блокировок
+	static Buffer& threadBuffer()
+	{
+		thread_local Buffer* buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			State& s = state();
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.buffers.push_back(std::make_unique<Buffer>());
+			buffer = s.buffers.back().get();
+			buffer->thread = s.buffers.size();
+		}
+		return *buffer;
+	}
+	
+	// Время в микросекундах с тремя знаками после точки
+	static void writeMicroseconds(std::ostream& out, long long ns)
+	{
+		out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000 << std::setfill(' ');
+	}
+	
+	static void write()
+	{
+		enabled = false;
+		State& s = state();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		std::ofstream out(s.path);
+		out << "{\"traceEvents\":[";
+		bool first = true;
+		for (const std::unique_ptr<Buffer>& buffer : s.buffers)
+		{
+			for (const Event& event : buffer->events)
+			{
+				out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.operation
+				    << "\",\"cat\":\"operation\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread << ",\"ts\":";
+				writeMicroseconds(out, event.start);
+				out << ",\"dur\":";
+				writeMicroseconds(out, event.duration);
+				out << "}";
+				first = false;
+			}
+		}
+		out << "\n]}\n";
+	}
+};
+
+/**
+ * @brief Замер одной операции для статистики и трассировки: от создания
+ *        объекта до его уничтожения. Вложенные замеры учитываются и во
+ *        внешней операции
+ */
+class OperationTimer
+{
+public:
+	OperationTimer(const char* operation, size_t elements)
+		: operation(operation), active(Statistics::isEnabled()), traced(Trace::isEnabled())
+	{
+		if (active)
+		{
+			start = Statistics::snapshot();
+			start.elements = elements;
+		}
+		if (active || traced)
+		{
+			startTime = std::chrono::steady_clock::now();
+		}
+	}
+	
+	OperationTimer(const OperationTimer&) = delete;
+	OperationTimer& operator=(const OperationTimer&) = delete;
+	
+	~OperationTimer()
+	{
+		if (!active && !traced)
+		{
+			return;
+		}
+		std::chrono::steady_clock::time_point finishTime = std::chrono::steady_clock::now();
+		if (active)
+		{
+			Statistics::Counters finish = Statistics::snapshot();
+			Statistics::Counters delta;
+			delta.calls = 1;
+			delta.nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(finishTime - startTime).count();
+			delta.elements = start.elements;
+			delta.probes = finish.probes - start.probes;
+			delta.allocations = finish.allocations - start.allocations;
+			delta.allocatedBytes = finish.allocatedBytes - start.allocatedBytes;
+			Statistics::record(operation, delta);
+		}
+		if (traced)
+		{
+			Trace::record(operation, startTime, finishTime);
+		}
+	}
+
+private:
+	const char* operation;
+	bool active;
+	bool traced;
+	Statistics::Counters start;
+	std::chrono::steady_clock::time_point startTime;
+};
+
+// Счётчик выделений памяти для статистики: все выделения через new проходят здесь.
+// operator delete не встраивается, иначе GCC ошибочно считает пару new/free несогласованной
+void* operator new(size_t size)
+{
+	Statistics::countAllocation(size);
+	void* pointer = std::malloc(size != 0 ? size : 1);
+	if (pointer == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+/**
+ * @brief Линейный поиск элемента в неотсортированном массиве int
+ *
+ * @return size_t позиция первого вхождения или n, если элемента нет
+ */
+size_t findIntScalar(const int* values, size_t n, int element)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		if (values[i] == element)
+		{
+			return i;
+		}
+	}
+	return n;
+}
+
+/**
+ * @brief Линейный поиск пары в неотсортированном массиве пар
+ *
+ * @return size_t позиция первого вхождения или n, если пары нет
+ */
+size_t findPairScalar(const std::pair<int, int>* values, size_t n, const std::pair<int, int>& element)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		if (values[i] == element)
+		{
+			return i;
+		}
+	}
+	return n;
+}
+
+#if SIMD_MEMBERSHIP
+// Векторные варианты просматривают блок из четырёх регистров за итерацию и при
+// совпадении в блоке передают остаток скалярному поиску, который найдёт его в
+// пределах блока. Пара int сравнивается как одно 64-битное слово
+
+__attribute__((target("sse2")))
+size_t findIntSse2(const int* values, size_t n, int element)
+{
+	const __m128i needle = _mm_set1_epi32(element);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i a = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + i)), needle);
+		__m128i b = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + i + 4)), needle);
+		__m128i c = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + i + 8)), needle);
+		__m128i d = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values + i + 12)), needle);
+		if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0)
+		{
+			break;
+		}
+	}
+	return i + findIntScalar(values + i, n - i, element);
+}
+
+__attribute__((target("avx2")))
+size_t findIntAvx2(const int* values, size_t n, int element)
+{
+	const __m256i needle = _mm256_set1_epi32(element);
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32)
+	{
+		__m256i a = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + i)), needle);
+		__m256i b = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + i + 8)), needle);
+		__m256i c = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + i + 16)), needle);
+		__m256i d = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(values + i + 24)), needle);
+		if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)) ||
+		    !_mm256_testz_si256(_mm256_or_si256(c, d), _mm256_or_si256(c, d)))
+		{
+			break;
+		}
+	}
+	return i + findIntScalar(values + i, n - i, element);
+}
+
+__attribute__((target("sse4.1")))
+size_t findPairSse41(const std::pair<int, int>* values, size_t n, const std::pair<int, int>& element)
+{
+	long long word;
+	std::memcpy(&word, &element, sizeof(word));
+	const __m128i needle = _mm_set1_epi64x(word);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i a = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(values + i)), needle);
+		__m128i b = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(values + i + 2)), needle);
+		__m128i c = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(values + i + 4)), needle);
+		__m128i d = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i*)(values + i + 6)), needle);
+		if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0)
+		{
+			break;
+		}
+	}
+	return i + findPairScalar(values + i, n - i, element);
+}
+
+__attribute__((target("avx2")))
+size_t findPairAvx2(const std::pair<int, int>* values, size_t n, const std::pair<int, int>& element)
+{
+	long long word;
+	std::memcpy(&word, &element, sizeof(word));
+	const __m256i needle = _mm256_set1_epi64x(word);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m256i a = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(values + i)), needle);
+		__m256i b = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(values + i + 4)), needle);
+		__m256i c = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(values + i + 8)), needle);
+		__m256i d = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(values + i + 12)), needle);
+		if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)) ||
+		    !_mm256_testz_si256(_mm256_or_si256(c, d), _mm256_or_si256(c, d)))
+		{
+			break;
+		}
+	}
+	return i + findPairScalar(values + i, n - i, element);
+}
+#endif
+
+/**
+ * @brief Позиция первого вхождения элемента в массив int. Реализация
+ *        выбирается при первом вызове по возможностям процессора: AVX2, SSE2
+ *        или скалярный цикл
+ *
+ * @return size_t позиция первого вхождения или n, если элемента нет
+ */
+size_t findPosition(const int* values, size_t n, int element)
+{
+	using Search = size_t (*)(const int*, size_t, int);
+	static const Search search = []() -> Search
+	{
+#if SIMD_MEMBERSHIP
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+		{
+			return findIntAvx2;
+		}
+		if (__builtin_cpu_supports("sse2"))
+		{
+			return findIntSse2;
+		}
+#endif
+		return findIntScalar;
+	}();
+	return search(values, n, element);
+}
+
+/**
+ * @brief Позиция первого вхождения пары в массив пар. Реализация выбирается
+ *        при первом вызове по возможностям процессора: AVX2, SSE4.1 или
+ *        скалярный цикл
+ *
+ * @return size_t позиция первого вхождения или n, если пары нет
+ */
+size_t findPosition(const std::pair<int, int>* values, size_t n, const std::pair<int, int>& element)
+{
+	using Search = size_t (*)(const std::pair<int, int>*, size_t, const std::pair<int, int>&);
+	static const Search search = []() -> Search
+	{
+#if SIMD_MEMBERSHIP
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+		{
+			return findPairAvx2;
+		}
+		if (__builtin_cpu_supports("sse4.1"))
+		{
+			return findPairSse41;
+		}
+#endif
+		return findPairScalar;
+	}();
+	return search(values, n, element);
+}
+
+/**
+ * @brief Позиция первого вхождения элемента произвольного типа (std::find)
+ */
+template<typename T>
+size_t findPosition(const T* values, size_t n, const T& element)
+{
+	return (size_t)(std::find(values, values + n, element) - values);
+}
+
+/**
+ * @brief Двоичный поиск без ветвлений: граница сдвигается условной
+ *        пересылкой, а не переходом, поэтому число шагов не зависит от
+ *        данных и нет ошибок предсказания переходов
+ *
+ * @param values отсортированный массив
+ * @param n длина массива
+ * @param element искомый элемент
+ * @return size_t позиция первого элемента, не меньшего искомого
+ */
+template<typename T>
+size_t branchlessLowerBound(const T* values, size_t n, const T& element)
+{
+	if (n == 0)
+	{
+		return 0;
+	}
+	
+	const T* base = values;
+	while (n > 1)
+	{
+		size_t half = n / 2;
+		base = (base[half - 1] < element) ? base + half : base;
+		n -= half;
+	}
+	
+	return (size_t)(base - values) + ((*base < element) ? 1 : 0);
+}
+
+/**
+ * @brief Галопирующий поиск от позиции from: шаг удваивается, пока элементы
+ *        меньше искомого, затем найденный отрезок досматривается двоичным
+ *        поиском. Для серии возрастающих запросов стоит O(log d), где d -
+ *        расстояние от предыдущей найденной позиции
+ *
+ * @param values отсортированный массив
+ * @param from позиция, до которой все элементы меньше искомого
+ * @param n длина массива
+ * @param element искомый элемент
+ * @return size_t позиция первого элемента, не меньшего искомого
+ */
+template<typename T>
+size_t gallopingLowerBound(const T* values, size_t from, size_t n, const T& element)
+{
+	size_t low = from, bound = 1;
+	while (from + bound <= n && values[from + bound - 1] < element)
+	{
+		low = from + bound;
+		bound *= 2;
+	}
+	size_t high = std::min(n, from + bound);
+	
+	return low + branchlessLowerBound(values + low, high - low, element);
+}
+
+/**
+ * @brief Проверка наличия элемента в отсортированном массиве
+ */
+template<typename T>
+bool sortedContains(const T* values, size_t n, const T& element)
+{
+	size_t position = branchlessLowerBound(values, n, element);
+	return position < n && values[position] == element;
+}
 
 /**
  * @brief Проверяет, наличие элемента в массиве
@@ -17,244 +619,1605 @@
 template<typename T>
 inline bool found(const std::vector<T>& a, const T& e)
 {
-	return std::any_of(a.begin(), a.end(), [e](const T& element)
+	size_t position = findPosition(a.data(), a.size(), e);
+	Statistics::countProbes(position + ((position != a.size()) ? 1 : 0));
+	return position != a.size();
+}
+
+/**
+ * @brief Ввод элементов множества целых чисел
+ *
+ * @param s множество
+ * @param name имя множества
+ */
+void inputSet(std::vector<int>& s, const std::string& name)
+{
+	OperationTimer timer("inputSet", 0);
+	std::cout << "Введите размер множества " << name << " (помните, что после "
+	             "ввода повторяющиеся элементы множества удаляются, что может "
+	             "привести к несоответствию желаемых и действительных размеров "
+	             "множества): ";
+	int size;
+	std::cin >> size;
+	s.reserve(size); // резервируем память для множества (для более быстрой работы ф-ции push_back)
+	
+	std::cout << "Введите множество " << name << ":\n";
+	for (int i = 0; i < size; i++)
 	{
-		return element == e;
-	});
+		int x;
+		std::cin >> x;
+		if (!found(s, x)) // если элемент уже был введен, то не добавляем его второй раз
+		{
+			s.push_back(x);
+		}
+	}
 }
 
 /**
- * @brief Ввод элементов множества целых чисел
+ * @brief Вывод элементов множества на экран
+ *
+ * @param s множество
+ */
+void printSet(const std::vector<int>& s)
+{
+	OperationTimer timer("printSet", s.size());
+	std::cout << "{"; // множество заключается в фигурные скобки
+	for (int i = 0; i < s.size(); i++)
+	{
+		std::cout << s[i];
+		if (i + 1 < s.size()) // после последнего элемента запятую не ставим
+		{
+			std::cout << ", ";
+		}
+	}
+	std::cout << "}\n"; // переходим на след. строку после вывода множества
+}
+
+/**
+ * @brief Ввод элементов графика
+ *
+ * @param g график
+ * @param name имя графика
+ */
+void inputGraph(std::vector< std::pair<int, int> >& g, const std::string& name)
+{
+	OperationTimer timer("inputGraph", 0);
+	std::cout << "Введите размер графика " << name << " (помните, что после "
+	             "ввода повторяющиеся элементы графика удаляются, что может "
+	             "привести к несоответствию желаемых и действительных размеров "
+	             "графика): ";
+	int size;
+	std::cin >> size;
+	g.reserve(size);
+	
+	std::cout << "Введите график " << name << " (помните, что элементы графика "
+	                                          "вводятся попарно):\n";
+	for (int i = 0; i < size; i++)
+	{
+		int x, y;
+		std::cin >> x >> y;
+		if (!found(g, {x, y}))
+		{
+			g.emplace_back(x, y);
+		}
+	}
+}
+
+/**
+ * @brief Вывод графика в консоль
+ *
+ * @param g график
+ */
+void printGraph(const std::vector< std::pair<int, int> >& g)
+{
+	OperationTimer timer("printGraph", g.size());
+	std::cout << "{";
+	for (int i = 0; i < g.size(); i++)
+	{
+		std::cout << "<" << g[i].first << ", " << g[i].second << ">"; // элементы графика (пары) заключаем в угловые скобки
+		if (i + 1 < g.size())
+		{
+			std::cout << ", ";
+		}
+	}
+	std::cout << "}\n";
+}
+
+/**
+ * @brief Ввод показателя степени графика
+ *
+ * @return size_t показатель степени k >= 0
+ */
+size_t inputExponent()
+{
+	long long k = 0;
+	do
+	{
+		std::cout << "Введите показатель степени k (целое неотрицательное число): ";
+	} while (std::cin >> k && k < 0);
+	
+	return k < 0 ? 0 : (size_t)k;
+}
+
+// Разброс значений на один элемент, до которого проекция идёт через битовую карту
+const size_t PROJECTION_BITMAP_SPAN_PER_ELEMENT = 64;
+// Начиная с этого числа пар проекция строится в несколько потоков
+const size_t PARALLEL_PROJECTION_THRESHOLD = 1 << 20;
+
+/**
+ * @brief Наименьшее и наибольшее значения непустого массива. На x86 проход
+ *        идёт по 4 значения в регистре SSE2
+ *
+ * @param values массив
+ * @param n длина массива
+ * @return std::pair<int, int> наименьшее и наибольшее значения
+ */
+std::pair<int, int> valueBounds(const int* values, size_t n)
+{
+	int low = values[0], high = values[0];
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	if (n >= 4)
+	{
+		__m128i lows = _mm_loadu_si128((const __m128i*)values), highs = lows;
+		for (i = 4; i + 4 <= n; i += 4)
+		{
+			__m128i current = _mm_loadu_si128((const __m128i*)(values + i));
+			// В SSE2 нет знакового минимума 32-битных чисел: выбор по маске сравнения
+			__m128i less = _mm_cmplt_epi32(current, lows);
+			lows = _mm_or_si128(_mm_and_si128(less, current), _mm_andnot_si128(less, lows));
+			__m128i greater = _mm_cmpgt_epi32(current, highs);
+			highs = _mm_or_si128(_mm_and_si128(greater, current), _mm_andnot_si128(greater, highs));
+		}
+		
+		int lanes[4];
+		_mm_storeu_si128((__m128i*)lanes, lows);
+		low = *std::min_element(lanes, lanes + 4);
+		_mm_storeu_si128((__m128i*)lanes, highs);
+		high = *std::max_element(lanes, lanes + 4);
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		low = std::min(low, values[i]);
+		high = std::max(high, values[i]);
+	}
+	
+	return {low, high};
+}
+
+/**
+ * @brief Различные значения массива в порядке возрастания за линейное время:
+ *        при небольшом разбросе значений - через битовую карту, иначе -
+ *        поразрядной сортировкой (LSD, по байту за проход, только по байтам
+ *        разброса) с удалением повторов
+ *
+ * @param values значения (порядок не важен)
+ * @return std::vector<int> различные значения по возрастанию
+ */
+std::vector<int> sortUnique(std::vector<int> values)
+{
+	if (values.empty())
+	{
+		return values;
+	}
+	
+	std::pair<int, int> bounds = valueBounds(values.data(), values.size());
+	uint32_t base = (uint32_t)bounds.first;
+	uint32_t span = (uint32_t)bounds.second - base;
+	
+	if (span / PROJECTION_BITMAP_SPAN_PER_ELEMENT <= values.size())
+	{
+		std::vector<uint64_t> bits(span / 64 + 1, 0);
+		for (int value : values)
+		{
+			uint32_t offset = (uint32_t)value - base;
+			bits[offset / 64] |= uint64_t(1) << (offset % 64);
+		}
+		
+		size_t count = 0;
+		for (size_t w = 0; w < bits.size(); w++)
+		{
+			for (uint64_t word = bits[w]; word != 0; word &= word - 1)
+			{
+				values[count++] = (int)(base + (uint32_t)(w * 64 + (size_t)__builtin_ctzll(word)));
+			}
+		}
+		values.resize(count);
+		return values;
+	}
+	
+	// Сортируются смещения от минимума: старшие нулевые байты разброса пропускаются
+	std::vector<uint32_t> keys(values.size()), buffer(values.size());
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		keys[i] = (uint32_t)values[i] - base;
+	}
+	for (uint32_t shift = 0; shift < 32 && (span >> shift) != 0; shift += 8)
+	{
+		size_t counts[256] = {};
+		for (uint32_t key : keys)
+		{
+			counts[(key >> shift) & 0xFF]++;
+		}
+		size_t position = 0;
+		for (size_t& count : counts)
+		{
+			size_t current = count;
+			count = position;
+			position += current;
+		}
+		for (uint32_t key : keys)
+		{
+			buffer[counts[(key >> shift) & 0xFF]++] = key;
+		}
+		keys.swap(buffer);
+	}
+	
+	size_t count = 0;
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		if (i == 0 || keys[i] != keys[i - 1])
+		{
+			values[count++] = (int)(base + keys[i]);
+		}
+	}
+	values.resize(count);
+	return values;
+}
+
+/**
+ * @brief Проекция графика на один из элементов пары: столбец извлекается и
+ *        очищается от повторов функцией sortUnique. Большой график делится
+ *        на части по числу ядер, части проецируются в разных потоках, а
+ *        результаты сливаются
+ *
+ * @param g график
+ * @param column проецируемый элемент пары (&std::pair<int, int>::first или ::second)
+ * @return std::vector<int> различные значения элемента по возрастанию
+ */
+std::vector<int> projection(const std::vector< std::pair<int, int> >& g, int std::pair<int, int>::* column)
+{
+	OperationTimer timer("projection", g.size());
+	auto project = [&g, column](size_t begin, size_t end)
+	{
+		std::vector<int> values;
+		values.reserve(end - begin);
+		for (size_t i = begin; i < end; i++)
+		{
+			values.push_back(g[i].*column);
+		}
+		return sortUnique(std::move(values));
+	};
+	
+	size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+	if (g.size() < PARALLEL_PROJECTION_THRESHOLD || threads == 1)
+	{
+		return project(0, g.size());
+	}
+	
+	size_t chunk = (g.size() + threads - 1) / threads;
+	std::vector< std::vector<int> > parts(threads);
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < threads; i++)
+	{
+		workers.emplace_back([&parts, &project, &g, i, chunk]()
+		{
+			parts[i] = project(std::min(g.size(), i * chunk), std::min(g.size(), (i + 1) * chunk));
+		});
+	}
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	
+	std::vector<int> result;
+	for (const std::vector<int>& part : parts)
+	{
+		std::vector<int> merged;
+		merged.reserve(result.size() + part.size());
+		std::set_union(result.begin(), result.end(), part.begin(), part.end(), std::back_inserter(merged));
+		result.swap(merged);
+	}
+	return result;
+}
+
+/**
+ * @brief Область определения графика
+ *
+ * @param g график
+ * @return std::vector<int> область определения графика (по возрастанию)
+ */
+std::vector<int> domainOfDefinition(const std::vector< std::pair<int, int> >& g)
+{
+	OperationTimer timer("domainOfDefinition", g.size());
+	return projection(g, &std::pair<int, int>::first);
+}
+
+/**
+ * @brief Область значений графика
+ *
+ * @param g график
+ * @return std::vector<int> область значений графика (по возрастанию)
+ */
+std::vector<int> range(const std::vector< std::pair<int, int> >& g)
+{
+	OperationTimer timer("range", g.size());
+	return projection(g, &std::pair<int, int>::second);
+}
+
+/**
+ * @brief Инверсия пары
+ *
+ * @param p пара
+ * @return std::pair<int, int> инвертированная пара
+ */
+inline std::pair<int, int> inversion(const std::pair<int, int>& p)
+{
+	return {p.second, p.first};
+}
+
+/**
+ * @brief Инверсия графика
+ *
+ * @param p график
+ * @return std::vector< std::pair<int, int> > инвертированный график
+ */
+std::vector< std::pair<int, int> > inversion(const std::vector< std::pair<int, int> >& p)
+{
+	OperationTimer timer("inversion", p.size());
+	std::vector< std::pair<int, int> > q(p.size());
+	
+	for (int i = 0; i < p.size(); i++)
+	{
+		q[i] = inversion(p[i]);
+	}
+	
+	return q;
+}
+
+/**
+ * @brief Инвертированный вид графика без копирования: пары читаются с
+ *        переставленными элементами через перестановку исходного графика,
+ *        упорядочивающую его по второму элементу (при равных сохраняется
+ *        исходный порядок), поэтому вид отсортирован по первому элементу. Перестановка строится
+ *        один раз и разделяется копиями вида. Исходный график должен жить
+ *        дольше вида и не меняться
+ */
+class InvertedGraph
+{
+public:
+	explicit InvertedGraph(const std::vector< std::pair<int, int> >& graph) : graph(&graph)
+	{
+		OperationTimer timer("InvertedGraph", graph.size());
+		std::shared_ptr< std::vector<size_t> > built = std::make_shared< std::vector<size_t> >(graph.size());
+		std::iota(built->begin(), built->end(), 0);
+		std::stable_sort(built->begin(), built->end(), [&graph](size_t i, size_t j)
+		{
+			return graph[i].second < graph[j].second;
+		});
+		order = built;
+	}
+	
+	/**
+	 * @brief Исходный (неинвертированный) график
+	 */
+	const std::vector< std::pair<int, int> >& getBase() const
+	{
+		return *graph;
+	}
+	
+	size_t size() const
+	{
+		return order->size();
+	}
+	
+	std::pair<int, int> operator[](size_t i) const
+	{
+		return inversion((*graph)[(*order)[i]]);
+	}
+	
+	/**
+	 * @brief Позиция первой пары вида, первый элемент которой не меньше first
+	 */
+	size_t lowerBound(int first) const
+	{
+		size_t low = 0, high = size();
+		while (low < high)
+		{
+			size_t middle = low + (high - low) / 2;
+			if ((*this)[middle].first < first)
+			{
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+		return low;
+	}
+	
+	/**
+	 * @brief Проверка наличия пары в виде двоичным поиском
+	 */
+	bool contains(const std::pair<int, int>& p) const
+	{
+		for (size_t i = lowerBound(p.first); i < size() && (*this)[i].first == p.first; i++)
+		{
+			if ((*this)[i].second == p.second)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	const std::vector< std::pair<int, int> >* graph;
+	std::shared_ptr< const std::vector<size_t> > order;
+};
+
+/**
+ * @brief Инвертированный вид графика (перестановка строится один раз)
+ *
+ * @param p график
+ * @return InvertedGraph вид инверсии графика P
+ */
+InvertedGraph inverted(const std::vector< std::pair<int, int> >& p)
+{
+	return InvertedGraph(p);
+}
+
+/**
+ * @brief Проверяет график на симметричность
+ *
+ * @param p график
+ * @return true если график симметричен
+ * @return false иначе
+ */
+bool isSymmetrical(const std::vector< std::pair<int, int> >& p)
+{
+	OperationTimer timer("isSymmetrical", p.size());
+	InvertedGraph q = inverted(p); // (x, y) есть в P^-1, если (y, x) есть в P
+	return std::all_of(p.begin(), p.end(), [&q](const std::pair<int, int>& element)
+	{
+		return q.contains(element);
+	});
+}
+
+/**
+ * @brief диагональ множества
+ *
+ * @param m множество
+ * @return std::vector< std::pair<int, int> > график, являющийся диагональю множества
+ */
+std::vector< std::pair<int, int> > diagonal(const std::vector<int>& m)
+{
+	OperationTimer timer("diagonal", m.size());
+	std::vector< std::pair<int, int> > dm(m.size());
+	
+	for (int i = 0; i < dm.size(); i++)
+	{
+		dm[i] = {m[i], m[i]};
+	}
+	
+	return dm;
+}
+
+/**
+ * @brief Композиция графика и инверсии другого графика (P o Q^-1) без
+ *        построения инверсии: продолжения пар P ищутся в виде двоичным поиском
+ *
+ * @param p график 1
+ * @param q вид инверсии графика 2
+ * @return std::vector< std::pair<int, int> > композиция графиков P и Q^-1
+ */
+std::vector< std::pair<int, int> > composition(const std::vector< std::pair<int, int> >& p, const InvertedGraph& q)
+{
+	OperationTimer timer("composition(inverted)", p.size() + q.size());
+	std::vector< std::pair<int, int> > result;
+	std::set< std::pair<int, int> > seen;
+	
+	for (const std::pair<int, int>& currentP : p)
+	{
+		for (size_t i = q.lowerBound(currentP.second); i < q.size() && q[i].first == currentP.second; i++)
+		{
+			if (seen.insert({currentP.first, q[i].second}).second) // не добавляем по 2 раза
+			{
+				result.emplace_back(currentP.first, q[i].second);
+			}
+		}
+	}
+	
+	return result;
+}
+
+/**
+ * @brief Композиция двух графиков
+ *
+ * @param p график 1
+ * @param q график 2
+ * @return std::vector< std::pair<int, int> > композиция графиков P и Q
+ */
+std::vector< std::pair<int, int> > composition(const std::vector< std::pair<int, int> >& p,
+                                               const std::vector< std::pair<int, int> >& q)
+{
+	OperationTimer timer("composition", p.size() + q.size());
+	// P o Q = P o (Q^-1)^-1: вид инверсии Q^-1 упорядочен по первым элементам
+	// Q, поэтому продолжения каждой пары P находятся двоичным поиском, а не
+	// перебором всего Q. Порядок результата тот же, что у перебора
+	std::vector< std::pair<int, int> > inverse = inversion(q);
+	return composition(p, inverted(inverse));
+}
+
+/**
+ * @brief Статистика графика для оценки мощности композиций: число пар,
+ *        различных первых и различных вторых элементов
+ */
+struct GraphStatistics
+{
+	double pairs;
+	double definition;
+	double value;
+};
+
+/**
+ * @brief Статистика графика
+ *
+ * @param g график
+ * @return GraphStatistics число пар и мощности области определения и области значений
+ */
+GraphStatistics graphStatistics(const std::vector< std::pair<int, int> >& g)
+{
+	std::vector<int> firsts, seconds;
+	firsts.reserve(g.size());
+	seconds.reserve(g.size());
+	for (const std::pair<int, int>& current : g)
+	{
+		firsts.push_back(current.first);
+		seconds.push_back(current.second);
+	}
+	std::sort(firsts.begin(), firsts.end());
+	std::sort(seconds.begin(), seconds.end());
+	
+	return {(double)g.size(),
+	        (double)(std::unique(firsts.begin(), firsts.end()) - firsts.begin()),
+	        (double)(std::unique(seconds.begin(), seconds.end()) - seconds.begin())};
+}
+
+/**
+ * @brief Оценка статистики композиции по статистикам сомножителей:
+ *        |P∘Q| ≈ |P|·|Q| / max(V(P.2), V(Q.1)), но не больше произведения
+ *        области определения P и области значений Q
+ */
+GraphStatistics composeStatistics(const GraphStatistics& p, const GraphStatistics& q)
+{
+	double pairs = p.pairs * q.pairs / std::max(1.0, std::max(p.value, q.definition));
+	pairs = std::min(pairs, p.definition * q.value);
+	return {pairs, std::min(p.definition, pairs), std::min(q.value, pairs)};
+}
+
+/**
+ * @brief Выбор порядка вычисления цепочки композиций динамическим
+ *        программированием, как в задаче о перемножении цепочки матриц. Для
+ *        каждого отрезка цепочки берётся разбиение с наименьшей суммой
+ *        оценок мощностей операндов и результатов всех композиций
+ *
+ * @param factors статистики графиков цепочки
+ * @return std::vector< std::vector<size_t> > split[i][j] - последний график
+ *         левой части для отрезка [i; j]
+ */
+std::vector< std::vector<size_t> > compositionChainSplits(const std::vector<GraphStatistics>& factors)
+{
+	size_t n = factors.size();
+	std::vector< std::vector<double> > cost(n, std::vector<double>(n, 0));
+	std::vector< std::vector<GraphStatistics> > estimate(n, std::vector<GraphStatistics>(n));
+	std::vector< std::vector<size_t> > split(n, std::vector<size_t>(n, 0));
+	for (size_t i = 0; i < n; i++)
+	{
+		estimate[i][i] = factors[i];
+	}
+	
+	for (size_t length = 2; length <= n; length++)
+	{
+		for (size_t i = 0; i + length <= n; i++)
+		{
+			size_t j = i + length - 1;
+			cost[i][j] = HUGE_VAL;
+			for (size_t k = i; k < j; k++)
+			{
+				GraphStatistics result = composeStatistics(estimate[i][k], estimate[k + 1][j]);
+				double total = cost[i][k] + cost[k + 1][j] +
+				               estimate[i][k].pairs + estimate[k + 1][j].pairs + result.pairs;
+				if (total < cost[i][j])
+				{
+					cost[i][j] = total;
+					estimate[i][j] = result;
+					split[i][j] = k;
+				}
+			}
+		}
+	}
+	
+	return split;
+}
+
+/**
+ * @brief Вычисление композиции графиков chain[i..j] в порядке из таблицы разбиений
+ */
+std::vector< std::pair<int, int> > evaluateCompositionChain(const std::vector< std::vector< std::pair<int, int> > >& chain,
+                                                            const std::vector< std::vector<size_t> >& split,
+                                                            size_t i, size_t j)
+{
+	if (i == j)
+	{
+		return chain[i];
+	}
+	return composition(evaluateCompositionChain(chain, split, i, split[i][j]),
+	                   evaluateCompositionChain(chain, split, split[i][j] + 1, j));
+}
+
+/**
+ * @brief Композиция цепочки графиков chain[0]∘chain[1]∘...∘chain[k - 1].
+ *        Композиция ассоциативна, поэтому порядок вычисления выбирается
+ *        заранее по статистикам графиков так, чтобы не получать огромных
+ *        промежуточных графиков. Множество пар результата от порядка не
+ *        зависит, порядок пар в нём - может
+ *
+ * @param chain графики
+ * @return std::vector< std::pair<int, int> > композиция всех графиков
+ */
+std::vector< std::pair<int, int> > compositionChain(const std::vector< std::vector< std::pair<int, int> > >& chain)
+{
+	OperationTimer timer("compositionChain", chain.size());
+	if (chain.empty())
+	{
+		return {};
+	}
+	
+	std::vector<GraphStatistics> statistics;
+	for (const std::vector< std::pair<int, int> >& g : chain)
+	{
+		statistics.push_back(graphStatistics(g));
+	}
+	return evaluateCompositionChain(chain, compositionChainSplits(statistics), 0, chain.size() - 1);
+}
+
+/**
+ * @brief Квадратная битовая матрица отношения на n элементах: строка i -
+ *        образы i-го элемента, по 64 элемента в слове
+ */
+class BitMatrix
+{
+public:
+	explicit BitMatrix(size_t n) : n(n), words((n + 63) / 64), bits(n * ((n + 63) / 64), 0)
+	{
+	}
+	
+	static BitMatrix identity(size_t n)
+	{
+		BitMatrix result(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			result.set(i, i);
+		}
+		return result;
+	}
+	
+	void set(size_t i, size_t j)
+	{
+		bits[i * words + j / 64] |= uint64_t(1) << (j % 64);
+	}
+	
+	bool test(size_t i, size_t j) const
+	{
+		return (bits[i * words + j / 64] >> (j % 64)) & 1;
+	}
+	
+	size_t size() const
+	{
+		return n;
+	}
+	
+	/**
+	 * @brief Булево произведение (композиция отношений): строка i результата -
+	 *        объединение строк other по всем единицам строки i этой матрицы
+	 */
+	BitMatrix operator*(const BitMatrix& other) const
+	{
+		BitMatrix result(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			uint64_t* target = &result.bits[i * words];
+			for (size_t w = 0; w < words; w++)
+			{
+				for (uint64_t word = bits[i * words + w]; word != 0; word &= word - 1)
+				{
+					const uint64_t* source = &other.bits[(w * 64 + (size_t)__builtin_ctzll(word)) * words];
+					for (size_t x = 0; x < words; x++)
+					{
+						target[x] |= source[x];
+					}
+				}
+			}
+		}
+		return result;
+	}
+	
+	BitMatrix operator|(const BitMatrix& other) const
+	{
+		BitMatrix result = *this;
+		for (size_t x = 0; x < bits.size(); x++)
+		{
+			result.bits[x] |= other.bits[x];
+		}
+		return result;
+	}
+
+private:
+	size_t n;
+	size_t words;
+	std::vector<uint64_t> bits;
+};
+
+/**
+ * @brief Степень битовой матрицы m^k (k >= 1) быстрым возведением в
+ *        степень: O(log k) умножений
+ */
+BitMatrix matrixPower(BitMatrix m, size_t k)
+{
+	BitMatrix result = m;
+	bool started = false;
+	while (true)
+	{
+		if (k & 1)
+		{
+			result = started ? result * m : m;
+			started = true;
+		}
+		k >>= 1;
+		if (k == 0)
+		{
+			return result;
+		}
+		m = m * m;
+	}
+}
+
+/**
+ * @brief Отношение на элементах 0..n-1 в виде списков смежности (CSR):
+ *        образы элемента i - targets[offsets[i]..offsets[i + 1]) по возрастанию
+ */
+struct SparseRelation
+{
+	std::vector<size_t> offsets;
+	std::vector<size_t> targets;
+};
+
+/**
+ * @brief Композиция разреженных отношений a∘b: строка i - объединение строк
+ *        b по всем образам i в a, повторы отсекаются метками
+ *
+ * @param limit наибольшее допустимое число пар результата
+ * @return std::optional<SparseRelation> композиция или std::nullopt, если
+ *         в ней больше limit пар
+ */
+std::optional<SparseRelation> sparseProduct(const SparseRelation& a, const SparseRelation& b, size_t limit)
+{
+	size_t n = a.offsets.size() - 1;
+	SparseRelation result;
+	result.offsets.assign(1, 0);
+	std::vector<size_t> mark(n, n); // mark[j] == i - j уже в строке i
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t rowStart = result.targets.size();
+		for (size_t e = a.offsets[i]; e < a.offsets[i + 1]; e++)
+		{
+			size_t middle = a.targets[e];
+			for (size_t f = b.offsets[middle]; f < b.offsets[middle + 1]; f++)
+			{
+				if (mark[b.targets[f]] != i)
+				{
+					mark[b.targets[f]] = i;
+					result.targets.push_back(b.targets[f]);
+				}
+			}
+		}
+		if (result.targets.size() > limit)
+		{
+			return std::nullopt;
+		}
+		std::sort(result.targets.begin() + (ptrdiff_t)rowStart, result.targets.end());
+		result.offsets.push_back(result.targets.size());
+	}
+	return result;
+}
+
+/**
+ * @brief Степень разреженного отношения m^k (k >= 1) быстрым возведением в
+ *        степень: O(log k) разреженных произведений
+ *
+ * @param limit наибольшее допустимое число пар в промежуточных степенях
+ * @return std::optional<SparseRelation> степень или std::nullopt, если
+ *         промежуточная степень разрослась больше limit пар
+ */
+std::optional<SparseRelation> sparsePower(SparseRelation m, size_t k, size_t limit)
+{
+	std::optional<SparseRelation> result;
+	while (true)
+	{
+		if (k & 1)
+		{
+			result = result ? sparseProduct(*result, m, limit) : std::optional<SparseRelation>(m);
+			if (!result)
+			{
+				return std::nullopt;
+			}
+		}
+		k >>= 1;
+		if (k == 0)
+		{
+			return result;
+		}
+		std::optional<SparseRelation> square = sparseProduct(m, m, limit);
+		if (!square)
+		{
+			return std::nullopt;
+		}
+		m = std::move(*square);
+	}
+}
+
+/**
+ * @brief Степень отношения R^k (upTo = false) или объединение степеней
+ *        R ∪ R^2 ∪ ... ∪ R^k (upTo = true), k >= 1. Элементы отношения
+ *        сжимаются в номера 0..n-1, затем по оценке стоимости выбирается
+ *        способ вычисления:
+ *        - плотное отношение - битовая матрица и быстрое возведение в
+ *          степень, R^(<=k) = R∘(I ∪ R)^(k-1);
+ *        - разреженное R^k - быстрое возведение в степень списков
+ *          смежности, O(log k) разреженных произведений;
+ *        - разреженное R^(<=k) - обход от каждого элемента области
+ *          определения по фронтам: фронт следующего шага - ещё не
+ *          достигнутая часть образа текущего фронта, поэтому каждый элемент
+ *          раскрывается не больше раза и стоимость O(n·|R|) не зависит от k.
+ *          Тот же обход без отсечения достигнутых считает R^k за O(n·|R|·k),
+ *          если промежуточные степени при возведении в квадрат разрастаются
+ *          больше MAX_SPARSE_POWER_GROWTH·|R| пар
+ *        Результат совпадает (как множество) с k-кратной композицией,
+ *        пары упорядочены по возрастанию
+ *
+ * @param r график отношения
+ * @param k показатель степени
+ * @param upTo объединять ли все степени от 1 до k
+ * @return std::vector< std::pair<int, int> > график степени отношения
+ */
+std::vector< std::pair<int, int> > relationPower(const std::vector< std::pair<int, int> >& r, size_t k, bool upTo)
+{
+	OperationTimer timer(upTo ? "powerUpTo" : "power", r.size());
+	std::vector< std::pair<int, int> > result;
+	if (k == 0 || r.empty())
+	{
+		return result;
+	}
+	
+	// Сжатие элементов отношения в номера
+	std::vector<int> field;
+	field.reserve(2 * r.size());
+	for (const std::pair<int, int>& current : r)
+	{
+		field.push_back(current.first);
+		field.push_back(current.second);
+	}
+	std::sort(field.begin(), field.end());
+	field.erase(std::unique(field.begin(), field.end()), field.end());
+	auto index = [&field](int element)
+	{
+		return branchlessLowerBound(field.data(), field.size(), element);
+	};
+	
+	size_t n = field.size();
+	std::vector< std::pair<size_t, size_t> > edges;
+	edges.reserve(r.size());
+	for (const std::pair<int, int>& current : r)
+	{
+		edges.emplace_back(index(current.first), index(current.second));
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	
+	// Оценки числа операций: плотный способ - O(log k) произведений по n^3/64,
+	// разреженный - обход рёбер от каждого источника (k раз для точной степени)
+	double steps = 0;
+	for (size_t e = k; e > 0; e >>= 1)
+	{
+		steps += 2;
+	}
+	double denseCost = steps * (double)n * (double)n * (double)((n + 63) / 64);
+	double sparseCost = (double)n * (double)edges.size() * (upTo ? 1.0 : (double)k);
+	const size_t MAX_DENSE_ELEMENTS = 16384; // матрица до 32 Мбайт
+	
+	if (n <= MAX_DENSE_ELEMENTS && denseCost < sparseCost)
+	{
+		BitMatrix m(n);
+		for (const std::pair<size_t, size_t>& edge : edges)
+		{
+			m.set(edge.first, edge.second);
+		}
+		BitMatrix p = upTo ? (k == 1 ? m : m * matrixPower(m | BitMatrix::identity(n), k - 1)) : matrixPower(m, k);
+		for (size_t i = 0; i < n; i++)
+		{
+			for (size_t j = 0; j < n; j++)
+			{
+				if (p.test(i, j))
+				{
+					result.emplace_back(field[i], field[j]);
+				}
+			}
+		}
+		return result;
+	}
+	
+	// Списки смежности: образы элемента i - targets[offsets[i]..offsets[i + 1])
+	std::vector<size_t> offsets(n + 1, 0), targets(edges.size());
+	for (const std::pair<size_t, size_t>& edge : edges)
+	{
+		offsets[edge.first + 1]++;
+	}
+	for (size_t i = 0; i < n; i++)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+	for (size_t e = 0; e < edges.size(); e++)
+	{
+		targets[e] = edges[e].second; // рёбра отсортированы по началу
+	}
+	
+	const size_t MAX_SPARSE_POWER_GROWTH = 64;
+	if (!upTo && k > 1)
+	{
+		size_t limit = std::max<size_t>(MAX_SPARSE_POWER_GROWTH * edges.size(), 1 << 20);
+		if (std::optional<SparseRelation> p = sparsePower({offsets, targets}, k, limit))
+		{
+			for (size_t i = 0; i < n; i++)
+			{
+				for (size_t e = p->offsets[i]; e < p->offsets[i + 1]; e++)
+				{
+					result.emplace_back(field[i], field[p->targets[e]]);
+				}
+			}
+			return result;
+		}
+	}
+	
+	std::vector<size_t> mark(n, 0), frontier, next, reached;
+	size_t stamp = 0;
+	for (size_t source = 0; source < n; source++)
+	{
+		if (offsets[source] == offsets[source + 1])
+		{
+			continue;
+		}
+		frontier.assign(1, source);
+		reached.clear();
+		size_t visited = ++stamp; // для R^(<=k) метка общая на все шаги
+		for (size_t step = 0; step < k && !frontier.empty(); step++)
+		{
+			size_t current = upTo ? visited : ++stamp;
+			next.clear();
+			for (size_t u : frontier)
+			{
+				for (size_t e = offsets[u]; e < offsets[u + 1]; e++)
+				{
+					if (mark[targets[e]] != current)
+					{
+						mark[targets[e]] = current;
+						next.push_back(targets[e]);
+					}
+				}
+			}
+			if (upTo)
+			{
+				reached.insert(reached.end(), next.begin(), next.end());
+			}
+			frontier.swap(next);
+		}
+		if (!upTo)
+		{
+			reached = frontier;
+		}
+		
+		std::sort(reached.begin(), reached.end());
+		for (size_t j : reached)
+		{
+			result.emplace_back(field[source], field[j]);
+		}
+	}
+	return result;
+}
+
+/**
+ * @brief Степень отношения R^k: композиция k экземпляров R
+ */
+std::vector< std::pair<int, int> > power(const std::vector< std::pair<int, int> >& r, size_t k)
+{
+	return relationPower(r, k, false);
+}
+
+/**
+ * @brief Достижимость не более чем за k шагов: R ∪ R^2 ∪ ... ∪ R^k
+ */
+std::vector< std::pair<int, int> > powerUpTo(const std::vector< std::pair<int, int> >& r, size_t k)
+{
+	return relationPower(r, k, true);
+}
+
+/**
+ * @brief Система непересекающихся множеств на элементах 0..n-1 (лес с
+ *        объединением по рангу и сжатием путей): поиск и объединение
+ *        работают за почти постоянное амортизированное время
+ */
+class DisjointSets
+{
+public:
+	explicit DisjointSets(size_t n) : parent(n), rank(n, 0)
+	{
+		std::iota(parent.begin(), parent.end(), 0);
+	}
+	
+	/**
+	 * @brief Представитель множества, содержащего i. Все элементы пройденного
+	 *        пути подвешиваются прямо к корню
+	 */
+	size_t find(size_t i)
+	{
+		size_t root = i;
+		while (parent[root] != root)
+		{
+			root = parent[root];
+		}
+		while (parent[i] != root)
+		{
+			size_t next = parent[i];
+			parent[i] = root;
+			i = next;
+		}
+		return root;
+	}
+	
+	/**
+	 * @brief Объединение множеств, содержащих i и j: корень меньшего ранга
+	 *        подвешивается к корню большего
+	 *
+	 * @return true если i и j были в разных множествах
+	 */
+	bool unite(size_t i, size_t j)
+	{
+		i = find(i);
+		j = find(j);
+		if (i == j)
+		{
+			return false;
+		}
+		if (rank[i] < rank[j])
+		{
+			std::swap(i, j);
+		}
+		parent[j] = i;
+		if (rank[i] == rank[j])
+		{
+			rank[i]++;
+		}
+		return true;
+	}
+
+private:
+	std::vector<size_t> parent;
+	std::vector<unsigned char> rank; // ранг не превосходит log2(n)
+};
+
+/**
+ * @brief Классы эквивалентности в компактном виде: элементы отношения по
+ *        возрастанию, номер класса каждого элемента и члены классов подряд -
+ *        члены класса c занимают members[offsets[c]..offsets[c + 1]) по
+ *        возрастанию. Классы пронумерованы по возрастанию наименьших членов
+ */
+struct EquivalenceClasses
+{
+	std::vector<int> elements;
+	std::vector<size_t> classOf; // classOf[i] - класс элемента elements[i]
+	std::vector<size_t> offsets;
+	std::vector<int> members;
+	
+	size_t count() const
+	{
+		return offsets.empty() ? 0 : offsets.size() - 1;
+	}
+	
+	/**
+	 * @brief Номер класса элемента или count(), если элемент не входит в отношение
+	 */
+	size_t find(int element) const
+	{
+		size_t i = branchlessLowerBound(elements.data(), elements.size(), element);
+		return (i < elements.size() && elements[i] == element) ? classOf[i] : count();
+	}
+	
+	/**
+	 * @brief Эквивалентны ли два элемента в замыкании отношения
+	 */
+	bool equivalent(int x, int y) const
+	{
+		size_t c = find(x);
+		return c != count() && c == find(y);
+	}
+};
+
+/**
+ * @brief Классы эквивалентности рефлексивно-симметрично-транзитивного
+ *        замыкания отношения: элементы сжимаются в номера, каждая пара
+ *        объединяет классы своих элементов в системе непересекающихся
+ *        множеств. O(|R| log |R|) на сжатие и почти линейное время на
+ *        объединения вместо повторных композиций
  *
- * @param s множество
- * @param name имя множества
+ * @param r график отношения
+ * @return EquivalenceClasses классы эквивалентности на элементах отношения
  */
-void inputSet(std::vector<int>& s, const std::string& name)
+EquivalenceClasses equivalenceClasses(const std::vector< std::pair<int, int> >& r)
 {
-	std::cout << "Введите размер множества " << name << " (помните, что после "
-	             "ввода повторяющиеся элементы множества удаляются, что может "
-	             "привести к несоответствию желаемых и действительных размеров "
-	             "множества): ";
-	int size;
-	std::cin >> size;
-	s.reserve(size); // резервируем память для множества (для более быстрой работы ф-ции push_back)
+	OperationTimer timer("equivalenceClasses", r.size());
+	EquivalenceClasses result;
+	std::vector<int>& field = result.elements;
+	field.reserve(2 * r.size());
+	for (const std::pair<int, int>& current : r)
+	{
+		field.push_back(current.first);
+		field.push_back(current.second);
+	}
+	field = sortUnique(std::move(field));
+	auto index = [&field](int element)
+	{
+		return branchlessLowerBound(field.data(), field.size(), element);
+	};
 	
-	std::cout << "Введите множество " << name << ":\n";
-	for (int i = 0; i < size; i++)
+	size_t n = field.size();
+	DisjointSets sets(n);
+	for (const std::pair<int, int>& current : r)
 	{
-		int x;
-		std::cin >> x;
-		if (!found(s, x)) // если элемент уже был введен, то не добавляем его второй раз
+		sets.unite(index(current.first), index(current.second));
+	}
+	
+	// Номера классов выдаются корням в порядке первого (наименьшего) члена,
+	// члены раскладываются по классам подсчётом, поэтому остаются по возрастанию
+	std::vector<size_t> classOfRoot(n, n);
+	result.classOf.resize(n);
+	result.offsets.assign(1, 0);
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t root = sets.find(i);
+		if (classOfRoot[root] == n)
 		{
-			s.push_back(x);
+			classOfRoot[root] = result.offsets.size() - 1;
+			result.offsets.push_back(0);
 		}
+		result.classOf[i] = classOfRoot[root];
+		result.offsets[result.classOf[i] + 1]++;
+	}
+	for (size_t c = 1; c < result.offsets.size(); c++)
+	{
+		result.offsets[c] += result.offsets[c - 1];
+	}
+	
+	result.members.resize(n);
+	std::vector<size_t> position(result.offsets.begin(), result.offsets.end() - 1);
+	for (size_t i = 0; i < n; i++)
+	{
+		result.members[position[result.classOf[i]]++] = field[i];
 	}
+	return result;
 }
 
 /**
- * @brief Вывод элементов множества на экран
+ * @brief График замыкания по классам эквивалентности: все пары членов
+ *        каждого класса, по возрастанию. Размер - сумма квадратов размеров
+ *        классов, поэтому строится только по требованию
  *
- * @param s множество
+ * @param classes классы эквивалентности
+ * @return std::vector< std::pair<int, int> > график отношения эквивалентности
  */
-void printSet(const std::vector<int>& s)
+std::vector< std::pair<int, int> > equivalenceClosure(const EquivalenceClasses& classes)
 {
-	std::cout << "{"; // множество заключается в фигурные скобки
-	for (int i = 0; i < s.size(); i++)
+	size_t total = 0;
+	for (size_t c = 0; c < classes.count(); c++)
 	{
-		std::cout << s[i];
-		if (i + 1 < s.size()) // после последнего элемента запятую не ставим
+		size_t size = classes.offsets[c + 1] - classes.offsets[c];
+		total += size * size;
+	}
+	OperationTimer timer("equivalenceClosure", total);
+	
+	std::vector< std::pair<int, int> > result;
+	result.reserve(total);
+	for (size_t i = 0; i < classes.elements.size(); i++)
+	{
+		size_t c = classes.classOf[i];
+		for (size_t k = classes.offsets[c]; k < classes.offsets[c + 1]; k++)
 		{
-			std::cout << ", ";
+			result.emplace_back(classes.elements[i], classes.members[k]);
 		}
 	}
-	std::cout << "}\n"; // переходим на след. строку после вывода множества
+	return result;
 }
 
 /**
- * @brief Ввод элементов графика
- *
- * @param g график
- * @param name имя графика
+ * @brief Наименьшее отношение эквивалентности на элементах R, содержащее R
  */
-void inputGraph(std::vector< std::pair<int, int> >& g, const std::string& name)
+std::vector< std::pair<int, int> > equivalenceClosure(const std::vector< std::pair<int, int> >& r)
 {
-	std::cout << "Введите размер графика " << name << " (помните, что после "
-	             "ввода повторяющиеся элементы графика удаляются, что может "
-	             "привести к несоответствию желаемых и действительных размеров "
-	             "графика): ";
-	int size;
-	std::cin >> size;
-	g.reserve(size);
-	
-	std::cout << "Введите график " << name << " (помните, что элементы графика "
-	                                          "вводятся попарно):\n";
-	for (int i = 0; i < size; i++)
-	{
-		int x, y;
-		std::cin >> x >> y;
-		if (!found(g, {x, y}))
-		{
-			g.emplace_back(x, y);
-		}
-	}
+	return equivalenceClosure(equivalenceClasses(r));
 }
 
 /**
- * @brief Вывод графика в консоль
+ * @brief Вывод классов эквивалентности на экран, по одному классу в строке
  *
- * @param g график
+ * @param classes классы эквивалентности
  */
-void printGraph(const std::vector< std::pair<int, int> >& g)
+void printClasses(const EquivalenceClasses& classes)
 {
-	std::cout << "{";
-	for (int i = 0; i < g.size(); i++)
+	for (size_t c = 0; c < classes.count(); c++)
 	{
-		std::cout << "<" << g[i].first << ", " << g[i].second << ">"; // элементы графика (пары) заключаем в угловые скобки
-		if (i + 1 < g.size())
-		{
-			std::cout << ", ";
-		}
+		printSet(std::vector<int>(classes.members.begin() + classes.offsets[c],
+		                          classes.members.begin() + classes.offsets[c + 1]));
 	}
-	std::cout << "}\n";
 }
 
 /**
- * @brief Область определения графика
+ * @brief Ограниченная очередь без блокировок для одного писателя и одного
+ *        читателя (кольцевой буфер). При пустой или полной очереди поток
+ *        уступает процессор и повторяет попытку
  *
- * @param g график
- * @return std::vector<int> область определения графика
+ * @tparam T тип элементов
  */
-std::vector<int> domainOfDefinition(const std::vector< std::pair<int, int> >& g)
+template<typename T>
+class SpscQueue
 {
-	std::vector<int> d;
-	d.reserve(g.size());
+public:
+	explicit SpscQueue(size_t capacity) : slots(capacity + 1)
+	{
+	}
 	
-	for (const std::pair<int, int>& current : g)
+	void push(T value)
 	{
-		if (!found(d, current.first))
+		size_t tail = tailIndex.load(std::memory_order_relaxed);
+		size_t next = (tail + 1) % slots.size();
+		while (next == headIndex.load(std::memory_order_acquire))
 		{
-			d.push_back(current.first);
+			std::this_thread::yield();
 		}
+		slots[tail] = std::move(value);
+		tailIndex.store(next, std::memory_order_release);
 	}
 	
-	return d;
-}
+	T pop()
+	{
+		size_t head = headIndex.load(std::memory_order_relaxed);
+		while (head == tailIndex.load(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+		T value = std::move(slots[head]);
+		headIndex.store((head + 1) % slots.size(), std::memory_order_release);
+		return value;
+	}
+
+private:
+	std::vector<T> slots;
+	// Индексы на разных строках кэша, чтобы писатель и читатель не мешали друг другу
+	alignas(64) std::atomic<size_t> headIndex{0};
+	alignas(64) std::atomic<size_t> tailIndex{0};
+};
 
 /**
- * @brief Область значений графика
+ * @brief Задание пакетного режима: номер операции, исходные данные и результаты
+ */
+struct BatchJob
+{
+	int operation = 0;
+	std::vector< std::pair<int, int> > p, q;
+	std::vector<int> m;
+	size_t k = 0;
+	
+	std::vector< std::pair<int, int> > r1, r2;
+	std::vector<int> set;
+	bool symmetrical = false;
+	EquivalenceClasses classes;
+};
+
+// Заранее резервируется не больше стольких элементов: размер во входных
+// данных не проверен, а при нехватке данных чтение всё равно прервётся
+const size_t MAX_BATCH_RESERVE = 1 << 16;
+
+/**
+ * @brief Чтение графика без подсказок: размер и пары, повторяющиеся пары
+ *        удаляются с сохранением порядка, как в inputGraph
  *
  * @param g график
- * @return std::vector<int> область значений графика
+ * @return true если график прочитан
+ * @return false если входные данные закончились или размер отрицателен
  */
-std::vector<int> range(const std::vector< std::pair<int, int> >& g)
+bool readGraph(std::vector< std::pair<int, int> >& g)
 {
-	std::vector<int> e;
-	e.reserve(g.size());
+	OperationTimer timer("readGraph", 0);
+	int size;
+	if (!(std::cin >> size) || size < 0)
+	{
+		return false;
+	}
+	g.reserve(std::min<size_t>((size_t)size, MAX_BATCH_RESERVE));
 	
-	for (const std::pair<int, int>& current : g)
+	std::set< std::pair<int, int> > seen;
+	for (int i = 0; i < size; i++)
 	{
-		if (!found(e, current.second))
+		int x, y;
+		if (!(std::cin >> x >> y))
+		{
+			return false;
+		}
+		if (seen.insert({x, y}).second)
 		{
-			e.push_back(current.second);
+			g.emplace_back(x, y);
 		}
 	}
-	
-	return e;
+	return true;
 }
 
 /**
- * @brief Инверсия пары
- *
- * @param p пара
- * @return std::pair<int, int> инвертированная пара
+ * @brief Чтение множества без подсказок: размер и элементы, повторы
+ *        удаляются с сохранением порядка, как в inputSet
  */
-inline std::pair<int, int> inversion(const std::pair<int, int>& p)
+bool readSet(std::vector<int>& s)
 {
-	return {p.second, p.first};
+	OperationTimer timer("readSet", 0);
+	int size;
+	if (!(std::cin >> size) || size < 0)
+	{
+		return false;
+	}
+	s.reserve(std::min<size_t>((size_t)size, MAX_BATCH_RESERVE));
+	
+	std::set<int> seen;
+	for (int i = 0; i < size; i++)
+	{
+		int x;
+		if (!(std::cin >> x))
+		{
+			return false;
+		}
+		if (seen.insert(x).second)
+		{
+			s.push_back(x);
+		}
+	}
+	return true;
 }
 
 /**
- * @brief Инверсия графика
+ * @brief Чтение показателя степени без подсказок
  *
- * @param p график
- * @return std::vector< std::pair<int, int> > инвертированный график
+ * @return false если входные данные закончились или показатель отрицателен
  */
-std::vector< std::pair<int, int> > inversion(const std::vector< std::pair<int, int> >& p)
+bool readExponent(size_t& k)
 {
-	std::vector< std::pair<int, int> > q(p.size());
-	
-	for (int i = 0; i < p.size(); i++)
+	long long value;
+	if (!(std::cin >> value) || value < 0)
 	{
-		q[i] = inversion(p[i]);
+		return false;
 	}
-	
-	return q;
+	k = (size_t)value;
+	return true;
 }
 
 /**
- * @brief Проверяет график на симметричность
- *
- * @param p график
- * @return true если график симметричен
- * @return false иначе
+ * @brief Итог чтения задания пакетного режима
  */
-bool isSymmetrical(const std::vector< std::pair<int, int> >& p)
+enum class ReadStatus
 {
-	return !std::any_of(p.begin(), p.end(), [p](const std::pair<int, int>& element)
-	{
-		return !found(p, inversion(element));
-	});
-}
+	JOB,              // задание прочитано
+	END,              // входные данные закончились перед номером операции
+	UNKNOWN_OPERATION,
+	BAD_DATA          // исходные данные не читаются или оборваны
+};
 
 /**
- * @brief диагональ множества
+ * @brief Чтение следующего задания: номер операции и её исходные данные.
+ *        Конец ввода перед номером операции - нормальное завершение, всё
+ *        остальное - ошибка входных данных
  *
- * @param m множество
- * @return std::vector< std::pair<int, int> > график, являющийся диагональю множества
+ * @param job задание
+ * @return ReadStatus итог чтения
  */
-std::vector< std::pair<int, int> > diagonal(const std::vector<int>& m)
+ReadStatus readJob(BatchJob& job)
 {
-	std::vector< std::pair<int, int> > dm(m.size());
-	
-	for (int i = 0; i < dm.size(); i++)
+	if (!(std::cin >> job.operation))
 	{
-		dm[i] = {m[i], m[i]};
+		return (std::cin.eof() && !std::cin.bad()) ? ReadStatus::END : ReadStatus::BAD_DATA;
+	}
+	bool read;
+	switch (job.operation) {
+		case 3:
+			read = readSet(job.m);
+			break;
+		case 4:
+			read = readGraph(job.p) && readGraph(job.q);
+			break;
+		case 1:
+		case 2:
+		case 5:
+		case 6:
+		case 9:
+			read = readGraph(job.p);
+			break;
+		case 7:
+		case 8:
+			read = readGraph(job.p) && readExponent(job.k);
+			break;
+		default:
+			return ReadStatus::UNKNOWN_OPERATION;
+	}
+	return read ? ReadStatus::JOB : ReadStatus::BAD_DATA;
+}
+
+void computeJob(BatchJob& job)
+{
+	switch (job.operation) {
+		case 1:
+			job.r1 = inversion(job.p);
+			break;
+		case 2:
+			job.symmetrical = isSymmetrical(job.p);
+			break;
+		case 3:
+			job.r1 = diagonal(job.m);
+			break;
+		case 4:
+			job.r1 = composition(job.p, job.q);
+			job.r2 = composition(job.q, job.p);
+			break;
+		case 5:
+			job.set = domainOfDefinition(job.p);
+			break;
+		case 6:
+			job.set = range(job.p);
+			break;
+		case 7:
+			job.r1 = power(job.p, job.k);
+			break;
+		case 8:
+			job.r1 = powerUpTo(job.p, job.k);
+			break;
+		case 9:
+			job.classes = equivalenceClasses(job.p);
+			job.r1 = equivalenceClosure(job.classes);
+			break;
+	}
+}
+
+void printJob(const BatchJob& job)
+{
+	switch (job.operation) {
+		case 2:
+			std::cout << "График P " << (job.symmetrical ? "" : "не ") << "является симметричным.\n";
+			break;
+		case 4:
+			printGraph(job.r1);
+			printGraph(job.r2);
+			break;
+		case 5:
+		case 6:
+			printSet(job.set);
+			break;
+		case 9:
+			printClasses(job.classes);
+			printGraph(job.r1);
+			break;
+		default:
+			printGraph(job.r1);
 	}
-	
-	return dm;
 }
 
 /**
- * @brief Композиция двух графиков
+ * @brief Пакетный режим: задания (номер операции и данные в том же порядке,
+ *        что и в диалоге, но без подсказок) читаются до конца ввода.
+ *        Чтение, вычисление и вывод работают в разных потоках и связаны
+ *        ограниченными очередями, поэтому следующее задание читается, пока
+ *        текущее вычисляется, а предыдущее выводится. На некорректном
+ *        задании обработка останавливается после вывода предыдущих
  *
- * @param p график 1
- * @param q график 2
- * @return std::vector< std::pair<int, int> > композиция графиков P и Q
+ * @return int код завершения: 0 или 1 при ошибке во входных данных
  */
-std::vector< std::pair<int, int> > composition(const std::vector< std::pair<int, int> >& p,
-                                               const std::vector< std::pair<int, int> >& q)
+int runBatch()
 {
-	std::vector< std::pair<int, int> > result;
+	const size_t QUEUE_CAPACITY = 16;
+	// Ввод и вывод работают в разных потоках, поэтому чтение не должно сбрасывать std::cout
+	std::ios::sync_with_stdio(false);
+	std::cin.tie(nullptr);
+	SpscQueue< std::optional<BatchJob> > parsed(QUEUE_CAPACITY), computed(QUEUE_CAPACITY);
+	ReadStatus status = ReadStatus::END; // пишет поток чтения, читается после join
+	size_t jobs = 0;
 	
-	for (const std::pair<int, int>& currentP : p)
+	std::thread parser([&parsed, &status, &jobs]()
 	{
-		for (const std::pair<int, int>& currentQ : q)
+		while (true)
 		{
-			if (currentP.second == currentQ.first)
+			BatchJob job;
+			status = readJob(job);
+			if (status != ReadStatus::JOB)
 			{
-				if (!found(result, {currentP.first, currentQ.second})) // не добавляем по 2 раза
-				{
-					result.emplace_back(currentP.first, currentQ.second);
-				}
+				break;
 			}
+			jobs++;
+			parsed.push(std::move(job));
+		}
+		parsed.push(std::nullopt); // конец потока заданий
+	});
+	std::thread calculator([&parsed, &computed]()
+	{
+		while (std::optional<BatchJob> job = parsed.pop())
+		{
+			computeJob(*job);
+			computed.push(std::move(job));
 		}
+		computed.push(std::nullopt);
+	});
+	
+	while (std::optional<BatchJob> job = computed.pop())
+	{
+		printJob(*job);
 	}
+	std::cout.flush();
 	
-	return result;
+	parser.join();
+	calculator.join();
+	
+	switch (status) {
+		case ReadStatus::UNKNOWN_OPERATION:
+			std::cerr << "Ошибка в задании " << jobs + 1 << ": неизвестная операция.\n";
+			return 1;
+		case ReadStatus::BAD_DATA:
+			std::cerr << "Ошибка в задании " << jobs + 1 << ": некорректные или неполные данные.\n";
+			return 1;
+		default:
+			return 0;
+	}
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+	// --stats - вывод статистики выполнения операций в stderr при выходе,
+	// --trace=файл - запись трассировки операций в файл при выходе
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--stats") == 0)
+		{
+			Statistics::enable();
+		}
+		else if (std::strncmp(argv[i], "--trace=", 8) == 0)
+		{
+			Trace::enable(argv[i] + 8);
+		}
+	}
+	
+	// --batch - пакетная обработка заданий до конца ввода
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--batch") == 0)
+		{
+			return runBatch();
+		}
+	}
+	
 	std::cout << "Выберите операцию, которую хотите произвести (для выбора "
 	             "введите номер пункта соответствующей операции):\n"
 	             "\t1. Инверсия графика.\n"
@@ -263,6 +2226,9 @@ int main()
 	             "\t4. Композиция графиков.\n"
 	             "\t5. Нахождение области определения графика.\n"
 	             "\t6. Нахождение области значений графика.\n"
+	             "\t7. Степень графика.\n"
+	             "\t8. Достижимость по графику не более чем за k шагов.\n"
+	             "\t9. Замыкание графика до отношения эквивалентности.\n"
 	             "Операция: ";
 	int operation;
 	std::cin >> operation;
@@ -341,6 +2307,47 @@ int main()
 			printSet(ep);
 		}
 			break;
+		case 7:
+		{
+			std::vector<std::pair<int, int> > p;
+			inputGraph(p, "P");
+			size_t k = inputExponent();
+			
+			std::vector<std::pair<int, int> > pk = power(p, k);
+			
+			std::cout << "Степенью P^k графика P является график, который "
+			             "выглядит следующим образом:\n";
+			printGraph(pk);
+		}
+			break;
+		case 8:
+		{
+			std::vector<std::pair<int, int> > p;
+			inputGraph(p, "P");
+			size_t k = inputExponent();
+			
+			std::vector<std::pair<int, int> > reachable = powerUpTo(p, k);
+			
+			std::cout << "Пары, достижимые по графику P не более чем за k шагов "
+			             "(P ∪ P^2 ∪ ... ∪ P^k):\n";
+			printGraph(reachable);
+		}
+			break;
+		case 9:
+		{
+			std::vector<std::pair<int, int> > p;
+			inputGraph(p, "P");
+			
+			EquivalenceClasses classes = equivalenceClasses(p);
+			
+			std::cout << "Классы эквивалентности замыкания графика P (всего "
+			          << classes.count() << "):\n";
+			printClasses(classes);
+			std::cout << "Замыканием графика P до отношения эквивалентности "
+			             "является график, который выглядит следующим образом:\n";
+			printGraph(equivalenceClosure(classes));
+		}
+			break;
 		default:
 			std::cout << "Ошибка! Неизвестная операция.\n";
 	}
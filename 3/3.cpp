@@ -2,6 +2,652 @@
 #include <map>
 #include <clocale>
 #include <iostream>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <cstdlib>
+#include <memory_resource>
+#include <memory>
+#include <functional>
+#include <iterator>
+#include <climits>
+#include <cmath>
+#include <unordered_set>
+#include <cstdint>
+#include <queue>
+#include <tuple>
+#include <thread>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <new>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <numeric>
+#include <shared_mutex>
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Векторный поиск с выбором реализации во время выполнения (GCC и Clang на x86)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_MEMBERSHIP 1
+#include <immintrin.h>
+#else
+#define SIMD_MEMBERSHIP 0
+#endif
+
+/**
+ * @brief Сбор статистики выполнения операций (ключ --stats): число вызовов,
+ *        время, обработанные элементы, сравнения и выделения памяти по
+ *        каждой операции. Итоговая таблица выводится в stderr при выходе.
+ *        Пока сбор выключен, замер стоит одной проверки флага
+ */
+class Statistics {
+public:
+	struct Counters {
+		size_t calls = 0;
+		long long nanoseconds = 0;
+		size_t elements = 0;
+		size_t probes = 0;
+		size_t allocations = 0;
+		size_t allocatedBytes = 0;
+	};
+	
+	static bool isEnabled() {
+		return enabled;
+	}
+	
+	/**
+	 * @brief Включение сбора статистики и вывода таблицы при выходе из программы
+	 */
+	static void enable() {
+		state(); // таблица должна быть создана до регистрации std::atexit
+		enabled = true;
+		std::call_once(registered, []() {
+			std::atexit(print);
+		});
+	}
+	
+	/**
+	 * @brief Учёт n сравнений (проверок принадлежности)
+	 */
+	static void countProbes(size_t n) {
+		if (enabled) {
+			probes.fetch_add(n, std::memory_order_relaxed);
+		}
+	}
+	
+	/**
+	 * @brief Учёт выделения памяти (вызывается из operator new)
+	 */
+	static void countAllocation(size_t bytes) {
+		if (enabled) {
+			allocations.fetch_add(1, std::memory_order_relaxed);
+			allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+		}
+	}
+	
+	/**
+	 * @brief Текущие значения счётчиков сравнений и выделений памяти
+	 */
+	static Counters snapshot() {
+		Counters result;
+		result.probes = probes.load(std::memory_order_relaxed);
+		result.allocations = allocations.load(std::memory_order_relaxed);
+		result.allocatedBytes = allocatedBytes.load(std::memory_order_relaxed);
+		return result;
+	}
+	
+	static void record(const char *operation, const Counters &delta) {
+		State &s = state();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		Counters &total = s.table[operation];
+		total.calls += delta.calls;
+		total.nanoseconds += delta.nanoseconds;
+		total.elements += delta.elements;
+		total.probes += delta.probes;
+		total.allocations += delta.allocations;
+		total.allocatedBytes += delta.allocatedBytes;
+	}
+
+private:
+	struct State {
+		std::mutex mutex;
+		std::map<std::string, Counters> table;
+	};
+	
+	static inline std::atomic<bool> enabled{false}; // читается из рабочих потоков
+	static inline std::once_flag registered; // повторный ключ не регистрирует вывод снова
+	static inline std::atomic<size_t> probes{0};
+	static inline std::atomic<size_t> allocations{0};
+	static inline std::atomic<size_t> allocatedBytes{0};
+	
+	static State &state() {
+		static State s;
+		return s;
+	}
+	
+	static void print() {
+		enabled = false;
+		State &s = state();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		// Заголовок выровнен заранее: std::setw считает байты, а не символы кириллицы
+		std::cerr << "\nСтатистика операций:\n"
+		             "операция                   вызовов    время, мкс   элементов   сравнений   выделений          байт\n";
+		for (const auto &entry : s.table) {
+			const Counters &c = entry.second;
+			std::cerr << std::left << std::setw(24) << entry.first << std::right
+			          << std::setw(10) << c.calls << std::setw(14) << c.nanoseconds / 1000
+			          << std::setw(12) << c.elements << std::setw(12) << c.probes
+			          << std::setw(12) << c.allocations << std::setw(14) << c.allocatedBytes << "\n";
+		}
+	}
+};
+
+/**
+ * @brief Трассировка операций (ключ --trace=файл) в формате Chrome trace
+ *        events (chrome://tracing, Perfetto): каждая операция - отрезок
+ *        времени с номером потока, вложенные операции видны как вложенные
+ *        отрезки. События пишутся в буфер своего потока без блокировок,
+ *        файл записывается при выходе из программы
+ */
+class Trace {
+public:
+	static bool isEnabled() {
+		return enabled;
+	}
+	
+	/**
+	 * @brief Включение трассировки с записью в файл path при выходе из программы
+	 */
+	static void enable(const std::string &path) {
+		state().path = path; // состояние должно быть создано до регистрации std::atexit
+		origin = std::chrono::steady_clock::now();
+		enabled = true;
+		std::call_once(registered, []() {
+			std::atexit(write);
+		});
+	}
+	
+	static void record(const char *operation, std::chrono::steady_clock::time_point start,
+	                   std::chrono::steady_clock::time_point finish) {
+		threadBuffer().events.push_back({operation, nanoseconds(start - origin), nanoseconds(finish - start)});
+	}
+
+private:
+	struct Event {
+		const char *operation;
+		long long start;
+		long long duration;
+	};
+	
+	struct Buffer {
+		size_t thread = 0;
+		std::vector<Event> events;
+	};
+	
+	struct State {
+		std::mutex mutex;
+		std::string path;
+		std::vector< std::unique_ptr<Buffer> > buffers;
+	};
+	
+	static inline std::atomic<bool> enabled{false};
+	static inline std::once_flag registered;
+	static inline std::chrono::steady_clock::time_point origin;
+	
+	static State &state() {
+		static State s;
+		return s;
+	}
+	
+	static long long nanoseconds(std::chrono::steady_clock::duration d) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+	}
+	
+	// Буфер потока регистрируется один раз, дальше события пишутся без блокировок
+	static Buffer &threadBuffer() {
+		thread_local Buffer *buffer = nullptr;
+		if (buffer == nullptr) {
+			State &s = state();
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.buffers.push_back(std::make_unique<Buffer>());
+			buffer = s.buffers.back().get();
+			buffer->thread = s.buffers.size();
+		}
+		return *buffer;
+	}
+	
+	// Время в микросекундах с тремя знаками после точки
+	static void writeMicroseconds(std::ostream &out, long long ns) {
+		out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000 << std::setfill(' ');
+	}
+	
+	static void write() {
+		enabled = false;
+		State &s = state();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		std::ofstream out(s.path);
+		out << "{\"traceEvents\":[";
+		bool first = true;
+		for (const std::unique_ptr<Buffer> &buffer : s.buffers) {
+			for (const Event &event : buffer->events) {
+				out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.operation
+				    << "\",\"cat\":\"operation\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread << ",\"ts\":";
+				writeMicroseconds(out, event.start);
+				out << ",\"dur\":";
+				writeMicroseconds(out, event.duration);
+				out << "}";
+				first = false;
+			}
+		}
+		out << "\n]}\n";
+	}
+};
+
+/**
+ * @brief Замер одной операции для статистики и трассировки: от создания
+ *        объекта до его уничтожения. Вложенные замеры учитываются и во
+ *        внешней операции
+ */
+class OperationTimer {
+public:
+	OperationTimer(const char *operation, size_t elements)
+			: operation(operation), active(Statistics::isEnabled()), traced(Trace::isEnabled()) {
+		if (this->active) {
+			this->start = Statistics::snapshot();
+			this->start.elements = elements;
+		}
+		if (this->active || this->traced) {
+			this->startTime = std::chrono::steady_clock::now();
+		}
+	}
+	
+	OperationTimer(const OperationTimer &) = delete;
+	OperationTimer &operator=(const OperationTimer &) = delete;
+	
+	~OperationTimer() {
+		if (!this->active && !this->traced) {
+			return;
+		}
+		std::chrono::steady_clock::time_point finishTime = std::chrono::steady_clock::now();
+		if (this->active) {
+			Statistics::Counters finish = Statistics::snapshot();
+			Statistics::Counters delta;
+			delta.calls = 1;
+			delta.nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(finishTime - this->startTime).count();
+			delta.elements = this->start.elements;
+			delta.probes = finish.probes - this->start.probes;
+			delta.allocations = finish.allocations - this->start.allocations;
+			delta.allocatedBytes = finish.allocatedBytes - this->start.allocatedBytes;
+			Statistics::record(this->operation, delta);
+		}
+		// Трассировка пишется после снимка счётчиков: рост её буфера не относится к операции
+		if (this->traced) {
+			Trace::record(this->operation, this->startTime, finishTime);
+		}
+	}
+
+private:
+	const char *operation;
+	bool active;
+	bool traced;
+	Statistics::Counters start;
+	std::chrono::steady_clock::time_point startTime;
+};
+
+// Счётчик выделений памяти для статистики: все выделения через new проходят здесь.
+// operator delete не встраивается, иначе GCC ошибочно считает пару new/free несогласованной
+void *operator new(size_t size) {
+	Statistics::countAllocation(size);
+	void *pointer = std::malloc(size != 0 ? size : 1);
+	if (pointer == nullptr) {
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+[[gnu::noinline]] void operator delete(void *pointer) noexcept {
+	std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+/**
+ * @brief Текущий источник памяти для промежуточных результатов операций над
+ *        соответствиями. Вне арены - обычная куча
+ */
+thread_local std::pmr::memory_resource *currentMemoryResource = std::pmr::new_delete_resource();
+
+/**
+ * @brief Арена (монотонный аллокатор) на время одной операции или одного
+ *        запроса. Пока объект жив, все множества и графики, создаваемые
+ *        операциями над соответствиями, берут память из нескольких крупных
+ *        блоков, которые освобождаются разом при уничтожении арены.
+ *        Соответствия, созданные внутри арены, не должны её переживать
+ */
+class Arena {
+private:
+	std::pmr::monotonic_buffer_resource resource;
+	std::pmr::memory_resource *previous;
+public:
+	explicit Arena(size_t initialSize = 64 * 1024)
+			: resource(initialSize), previous(currentMemoryResource) {
+		currentMemoryResource = &this->resource;
+	}
+	
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+	
+	~Arena() {
+		currentMemoryResource = this->previous;
+	}
+};
+
+/**
+ * @brief Временная смена текущего источника памяти, например чтобы сохранить
+ *        результат за пределами активной арены
+ */
+class MemoryResourceScope {
+private:
+	std::pmr::memory_resource *previous;
+public:
+	explicit MemoryResourceScope(std::pmr::memory_resource *resource)
+			: previous(currentMemoryResource) {
+		currentMemoryResource = resource;
+	}
+	
+	MemoryResourceScope(const MemoryResourceScope &) = delete;
+	MemoryResourceScope &operator=(const MemoryResourceScope &) = delete;
+	
+	~MemoryResourceScope() {
+		currentMemoryResource = this->previous;
+	}
+};
+
+using IntVector = std::pmr::vector<int>;
+using PairVector = std::pmr::vector< std::pair<int, int> >;
+
+/**
+ * @brief 128-битный отпечаток содержимого. Отпечаток - сумма хешей элементов
+ *        по модулю 2^64 в двух независимых половинах, поэтому не зависит от
+ *        порядка элементов и пересчитывается при добавлении или удалении
+ *        одного элемента за O(1). Соль разделяет разные части объекта
+ *        (например, область отправления и график соответствия)
+ */
+struct Fingerprint {
+	uint64_t low = 0;
+	uint64_t high = 0;
+	
+	static uint64_t mix(uint64_t value, uint64_t seed) {
+		// Финализатор splitmix64
+		value += seed + 0x9e3779b97f4a7c15ULL;
+		value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+		return value ^ (value >> 31);
+	}
+	
+	static uint64_t key(int element) {
+		return (uint64_t)(uint32_t)element;
+	}
+	
+	static uint64_t key(const std::pair<int, int> &element) {
+		return ((uint64_t)(uint32_t)element.first << 32) | (uint64_t)(uint32_t)element.second;
+	}
+	
+	template<typename T>
+	void add(const T &element, uint64_t salt) {
+		this->low += mix(key(element), 0x243f6a8885a308d3ULL ^ salt);
+		this->high += mix(key(element), 0x13198a2e03707344ULL + salt);
+	}
+	
+	template<typename T>
+	void remove(const T &element, uint64_t salt) {
+		this->low -= mix(key(element), 0x243f6a8885a308d3ULL ^ salt);
+		this->high -= mix(key(element), 0x13198a2e03707344ULL + salt);
+	}
+	
+	bool operator==(const Fingerprint &other) const {
+		return this->low == other.low && this->high == other.high;
+	}
+};
+
+/**
+ * @brief Линейный поиск элемента в неотсортированном массиве int
+ *
+ * @return size_t позиция первого вхождения или n, если элемента нет
+ */
+size_t findIntScalar(const int *values, size_t n, int element) {
+	for (size_t i = 0; i < n; i++) {
+		if (values[i] == element) {
+			return i;
+		}
+	}
+	return n;
+}
+
+/**
+ * @brief Линейный поиск пары в неотсортированном массиве пар
+ *
+ * @return size_t позиция первого вхождения или n, если пары нет
+ */
+size_t findPairScalar(const std::pair<int, int> *values, size_t n, const std::pair<int, int> &element) {
+	for (size_t i = 0; i < n; i++) {
+		if (values[i] == element) {
+			return i;
+		}
+	}
+	return n;
+}
+
+#if SIMD_MEMBERSHIP
+// Векторные варианты просматривают блок из четырёх регистров за итерацию и при
+// совпадении в блоке передают остаток скалярному поиску, который найдёт его в
+// пределах блока. Пара int сравнивается как одно 64-битное слово
+
+__attribute__((target("sse2")))
+size_t findIntSse2(const int *values, size_t n, int element) {
+	const __m128i needle = _mm_set1_epi32(element);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m128i a = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(values + i)), needle);
+		__m128i b = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(values + i + 4)), needle);
+		__m128i c = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(values + i + 8)), needle);
+		__m128i d = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(values + i + 12)), needle);
+		if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0) {
+			break;
+		}
+	}
+	return i + findIntScalar(values + i, n - i, element);
+}
+
+__attribute__((target("avx2")))
+size_t findIntAvx2(const int *values, size_t n, int element) {
+	const __m256i needle = _mm256_set1_epi32(element);
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		__m256i a = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(values + i)), needle);
+		__m256i b = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(values + i + 8)), needle);
+		__m256i c = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(values + i + 16)), needle);
+		__m256i d = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(values + i + 24)), needle);
+		if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)) ||
+		    !_mm256_testz_si256(_mm256_or_si256(c, d), _mm256_or_si256(c, d))) {
+			break;
+		}
+	}
+	return i + findIntScalar(values + i, n - i, element);
+}
+
+__attribute__((target("sse4.1")))
+size_t findPairSse41(const std::pair<int, int> *values, size_t n, const std::pair<int, int> &element) {
+	long long word;
+	std::memcpy(&word, &element, sizeof(word));
+	const __m128i needle = _mm_set1_epi64x(word);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128i a = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i *)(values + i)), needle);
+		__m128i b = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i *)(values + i + 2)), needle);
+		__m128i c = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i *)(values + i + 4)), needle);
+		__m128i d = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i *)(values + i + 6)), needle);
+		if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0) {
+			break;
+		}
+	}
+	return i + findPairScalar(values + i, n - i, element);
+}
+
+__attribute__((target("avx2")))
+size_t findPairAvx2(const std::pair<int, int> *values, size_t n, const std::pair<int, int> &element) {
+	long long word;
+	std::memcpy(&word, &element, sizeof(word));
+	const __m256i needle = _mm256_set1_epi64x(word);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m256i a = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(values + i)), needle);
+		__m256i b = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(values + i + 4)), needle);
+		__m256i c = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(values + i + 8)), needle);
+		__m256i d = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(values + i + 12)), needle);
+		if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)) ||
+		    !_mm256_testz_si256(_mm256_or_si256(c, d), _mm256_or_si256(c, d))) {
+			break;
+		}
+	}
+	return i + findPairScalar(values + i, n - i, element);
+}
+#endif
+
+/**
+ * @brief Позиция первого вхождения элемента в массив int. Реализация
+ *        выбирается при первом вызове по возможностям процессора: AVX2, SSE2
+ *        или скалярный цикл
+ *
+ * @return size_t позиция первого вхождения или n, если элемента нет
+ */
+size_t findPosition(const int *values, size_t n, int element) {
+	using Search = size_t (*)(const int *, size_t, int);
+	static const Search search = []() -> Search {
+#if SIMD_MEMBERSHIP
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			return findIntAvx2;
+		}
+		if (__builtin_cpu_supports("sse2")) {
+			return findIntSse2;
+		}
+#endif
+		return findIntScalar;
+	}();
+	return search(values, n, element);
+}
+
+/**
+ * @brief Позиция первого вхождения пары в массив пар. Реализация выбирается
+ *        при первом вызове по возможностям процессора: AVX2, SSE4.1 или
+ *        скалярный цикл
+ *
+ * @return size_t позиция первого вхождения или n, если пары нет
+ */
+size_t findPosition(const std::pair<int, int> *values, size_t n, const std::pair<int, int> &element) {
+	using Search = size_t (*)(const std::pair<int, int> *, size_t, const std::pair<int, int> &);
+	static const Search search = []() -> Search {
+#if SIMD_MEMBERSHIP
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			return findPairAvx2;
+		}
+		if (__builtin_cpu_supports("sse4.1")) {
+			return findPairSse41;
+		}
+#endif
+		return findPairScalar;
+	}();
+	return search(values, n, element);
+}
+
+/**
+ * @brief Позиция первого вхождения элемента произвольного типа (std::find)
+ */
+template<typename T>
+size_t findPosition(const T *values, size_t n, const T &element) {
+	return (size_t)(std::find(values, values + n, element) - values);
+}
+
+/**
+ * @brief Двоичный поиск без ветвлений: граница сдвигается условной
+ *        пересылкой, а не переходом, поэтому число шагов не зависит от
+ *        данных и нет ошибок предсказания переходов
+ *
+ * @param values отсортированный массив
+ * @param n длина массива
+ * @param element искомый элемент
+ * @return size_t позиция первого элемента, не меньшего искомого
+ */
+template<typename T>
+size_t branchlessLowerBound(const T *values, size_t n, const T &element) {
+	if (n == 0) {
+		return 0;
+	}
+	
+	const T *base = values;
+	while (n > 1) {
+		size_t half = n / 2;
+		base = (base[half - 1] < element) ? base + half : base;
+		n -= half;
+	}
+	
+	return (size_t)(base - values) + ((*base < element) ? 1 : 0);
+}
+
+/**
+ * @brief Галопирующий поиск от позиции from: шаг удваивается, пока элементы
+ *        меньше искомого, затем найденный отрезок досматривается двоичным
+ *        поиском. Для серии возрастающих запросов стоит O(log d), где d -
+ *        расстояние от предыдущей найденной позиции
+ *
+ * @param values отсортированный массив
+ * @param from позиция, до которой все элементы меньше искомого
+ * @param n длина массива
+ * @param element искомый элемент
+ * @return size_t позиция первого элемента, не меньшего искомого
+ */
+template<typename T>
+size_t gallopingLowerBound(const T *values, size_t from, size_t n, const T &element) {
+	size_t low = from, bound = 1;
+	while (from + bound <= n && values[from + bound - 1] < element) {
+		low = from + bound;
+		bound *= 2;
+	}
+	size_t high = std::min(n, from + bound);
+	
+	return low + branchlessLowerBound(values + low, high - low, element);
+}
+
+/**
+ * @brief Проверка наличия элемента в отсортированном массиве
+ */
+template<typename T>
+bool sortedContains(const T *values, size_t n, const T &element) {
+	size_t position = branchlessLowerBound(values, n, element);
+	return position < n && values[position] == element;
+}
 
 /**
  * @brief Проверяет есть ли элемент в массиве
@@ -12,11 +658,11 @@
  * @return true если элемент найден
  * @return false если элемент не найден
  */
-template<typename T>
-bool found(const std::vector<T> &a, const T &e) {
-	return std::any_of(a.begin(), a.end(), [&e](const T &element) {
-		return element == e;
-	});
+template<typename T, typename Allocator>
+bool found(const std::vector<T, Allocator> &a, const T &e) {
+	size_t position = findPosition(a.data(), a.size(), e);
+	Statistics::countProbes(position + ((position != a.size()) ? 1 : 0));
+	return position != a.size();
 }
 
 /**
@@ -25,11 +671,14 @@ bool found(const std::vector<T> &a, const T &e) {
  * @tparam T тип элементов множества
  * @param x первое множество
  * @param y второе множество
- * @return std::vector<T> мн-во, являющееся объединением мн-в x и y
+ * @return std::pmr::vector<T> мн-во, являющееся объединением мн-в x и y
  */
-template<typename T>
-std::vector<T> unite(const std::vector<T> &x, const std::vector<T> &y) {
-	std::vector<T> result = x;
+template<typename T, typename Allocator1, typename Allocator2>
+std::pmr::vector<T> unite(const std::vector<T, Allocator1> &x, const std::vector<T, Allocator2> &y) {
+	OperationTimer timer("unite", x.size() + y.size());
+	std::pmr::vector<T> result(currentMemoryResource);
+	result.reserve(x.size() + y.size());
+	result.assign(x.begin(), x.end());
 	
 	for (size_t i = 0; i < y.size(); i++) {
 		if (!found(result, y[i])) {
@@ -46,11 +695,13 @@ std::vector<T> unite(const std::vector<T> &x, const std::vector<T> &y) {
  * @tparam T тип элементов множества
  * @param x первое множество
  * @param y второе множество
- * @return std::vector<T> мн-во, являющееся пересечением мн-в x и y
+ * @return std::pmr::vector<T> мн-во, являющееся пересечением мн-в x и y
  */
-template<typename T>
-std::vector<T> intersect(const std::vector<T> &x, const std::vector<T> &y) {
-	std::vector<T> result;
+template<typename T, typename Allocator1, typename Allocator2>
+std::pmr::vector<T> intersect(const std::vector<T, Allocator1> &x, const std::vector<T, Allocator2> &y) {
+	OperationTimer timer("intersect", x.size() + y.size());
+	std::pmr::vector<T> result(currentMemoryResource);
+	result.reserve(x.size());
 	
 	for (size_t i = 0; i < x.size(); i++) {
 		if (found(y, x[i])) {
@@ -67,11 +718,13 @@ std::vector<T> intersect(const std::vector<T> &x, const std::vector<T> &y) {
  * @tparam T тип элементов множества
  * @param x первое множество
  * @param y второе множество
- * @return std::vector<T> мн-во, являющееся разностью мн-в x и y
+ * @return std::pmr::vector<T> мн-во, являющееся разностью мн-в x и y
  */
-template<typename T>
-std::vector<T> difference(const std::vector<T> &x, const std::vector<T> &y) {
-	std::vector<T> result;
+template<typename T, typename Allocator1, typename Allocator2>
+std::pmr::vector<T> difference(const std::vector<T, Allocator1> &x, const std::vector<T, Allocator2> &y) {
+	OperationTimer timer("difference", x.size() + y.size());
+	std::pmr::vector<T> result(currentMemoryResource);
+	result.reserve(x.size());
 	
 	for (size_t i = 0; i < x.size(); i++) {
 		if (!found(y, x[i])) {
@@ -96,23 +749,34 @@ std::pair<int, int> inversion(const std::pair<int, int>& p) {
  * @brief Инверсия графика
  *
  * @param p график
- * @return std::vector< std::pair<int, int> > инвертированный график
+ * @return PairVector инвертированный график
  */
-std::vector< std::pair<int, int> > inversion(const std::vector< std::pair<int, int> >& p) {
-	std::vector< std::pair<int, int> > q(p.size());
+template<typename Allocator>
+PairVector inversion(const std::vector< std::pair<int, int>, Allocator >& p) {
+	OperationTimer timer("inversion", p.size());
+	PairVector q(p.size(), currentMemoryResource);
 	
-	for (int i = 0; i < p.size(); i++) {
+	for (size_t i = 0; i < p.size(); i++) {
 		q[i] = inversion(p[i]);
 	}
 	
 	return q;
 }
 
-std::vector< std::pair<int, int> > composition(
-		const std::vector< std::pair<int, int> >& p,
-		const std::vector< std::pair<int, int> >& q
+/**
+ * @brief Композиция двух графиков
+ *
+ * @param p график 1
+ * @param q график 2
+ * @return PairVector композиция графиков P и Q
+ */
+template<typename Allocator1, typename Allocator2>
+PairVector composition(
+		const std::vector< std::pair<int, int>, Allocator1 >& p,
+		const std::vector< std::pair<int, int>, Allocator2 >& q
 ) {
-	std::vector< std::pair<int, int> > result;
+	OperationTimer timer("composition", p.size() + q.size());
+	PairVector result(currentMemoryResource);
 	
 	for (const std::pair<int, int>& currentP : p) {
 		for (const std::pair<int, int>& currentQ : q) {
@@ -128,375 +792,2991 @@ std::vector< std::pair<int, int> > composition(
 }
 
 /**
- * @brief Соответствие
+ * @brief Позиция первой пары графика, отсортированного по первому элементу,
+ *        у которой первый элемент не меньше заданного
  *
+ * @tparam Graph график с size() и operator[] (PairVector или инвертированный вид)
+ * @param g график
+ * @param first первый элемент
+ * @return size_t позиция пары
  */
-class Accordance {
-private:
-	std::vector<int> departureArea;
-	std::vector<int> arrivalArea;
-	std::vector< std::pair<int, int> > graph;
-public:
-	explicit Accordance(
-			const std::vector<int> &departureArea = std::vector<int>(),
-			const std::vector<int> &arrivalArea = std::vector<int>(),
-			const std::vector< std::pair<int, int> > &graph = std::vector< std::pair<int, int> >()
-	)
-			: departureArea(departureArea), arrivalArea(arrivalArea), graph(graph) {
-		std::sort(this->departureArea.begin(), this->departureArea.end());
-		std::sort(this->arrivalArea.begin(), this->arrivalArea.end());
-		std::sort(this->graph.begin(), this->graph.end());
+template<typename Graph>
+size_t sortedLowerBound(const Graph &g, int first) {
+	size_t low = 0, high = g.size();
+	
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		if (g[middle].first < first) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
 	}
 	
-	explicit Accordance(const std::vector< std::vector<bool> > &matrix) {
-		for (size_t i = 0; i < matrix.size(); i++) {
-			for (size_t j = 0; j < matrix[i].size(); j++) {
-				if (matrix[i][j]) {
-					if (!found(this->departureArea, (int)(1 + i))) {
-						this->departureArea.push_back((int)(1 + i));
-					}
-					if (!found(this->arrivalArea, (int)(1 + j))) {
-						this->arrivalArea.push_back((int)(1 + j));
-					}
-					if (!found(this->graph, {1 + i, 1 + j})) {
-						this->graph.emplace_back(1 + i, 1 + j);
-					}
-				}
+	return low;
+}
+
+/**
+ * @brief Композиция графиков, отсортированных по первому элементу: пары
+ *        первого графика с одинаковым первым элементом обрабатываются вместе,
+ *        продолжения ищутся во втором графике двоичным поиском. Результат
+ *        отсортирован и не содержит повторов
+ *
+ * @tparam Left тип первого графика (PairVector или инвертированный вид)
+ * @tparam Right тип второго графика (PairVector или инвертированный вид)
+ * @param p график 1
+ * @param q график 2
+ * @return PairVector композиция графиков P и Q
+ */
+template<typename Left, typename Right>
+PairVector composeSortedGraphs(const Left &p, const Right &q) {
+	OperationTimer timer("composeSortedGraphs", p.size() + q.size());
+	PairVector result(currentMemoryResource);
+	IntVector targets(currentMemoryResource);
+	
+	for (size_t i = 0; i < p.size();) {
+		int from = p[i].first;
+		targets.clear();
+		for (; i < p.size() && p[i].first == from; i++) {
+			int middle = p[i].second;
+			for (size_t j = sortedLowerBound(q, middle); j < q.size() && q[j].first == middle; j++) {
+				targets.push_back(q[j].second);
 			}
 		}
 		
-		std::sort(this->departureArea.begin(), this->departureArea.end());
-		std::sort(this->arrivalArea.begin(), this->arrivalArea.end());
-		std::sort(this->graph.begin(), this->graph.end());
+		std::sort(targets.begin(), targets.end());
+		targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+		for (int to : targets) {
+			result.emplace_back(from, to);
+		}
 	}
 	
-	explicit Accordance(const std::vector< std::vector<int> > &graph) {
-		for (size_t i = 0; i < graph.size(); i++) {
+	return result;
+}
+
+// Начиная с этого числа множеств uniteAll/intersectAll работают в несколько потоков
+const size_t PARALLEL_SETS_THRESHOLD = 256;
+
+/**
+ * @brief k-путевое слияние отсортированных множеств с помощью кучи: из кучи
+ *        извлекается наименьший текущий элемент, повторы пропускаются
+ *
+ * @tparam Set тип множества (отсортированный массив)
+ * @param sets указатели на множества
+ * @param begin индекс первого сливаемого множества
+ * @param end индекс за последним сливаемым множеством
+ * @return Set объединение множеств sets[begin..end)
+ */
+template<typename Set>
+Set mergeSortedSets(const std::vector<const Set *> &sets, size_t begin, size_t end) {
+	using T = typename Set::value_type;
+	// Элемент кучи: (значение, номер множества, позиция в нём)
+	using Cursor = std::tuple<T, size_t, size_t>;
+	std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor> > heap;
+	
+	size_t total = 0;
+	for (size_t i = begin; i < end; i++) {
+		if (!sets[i]->empty()) {
+			heap.emplace((*sets[i])[0], i, 0);
+			total += sets[i]->size();
+		}
+	}
+	
+	Set result;
+	result.reserve(total);
+	while (!heap.empty()) {
+		Cursor top = heap.top();
+		heap.pop();
+		if (result.empty() || result.back() != std::get<0>(top)) {
+			result.push_back(std::get<0>(top));
+		}
+		
+		size_t set = std::get<1>(top), position = std::get<2>(top) + 1;
+		if (position < sets[set]->size()) {
+			heap.emplace((*sets[set])[position], set, position);
+		}
+	}
+	
+	return result;
+}
+
+/**
+ * @brief Пересечение отсортированных множеств, упорядоченных по возрастанию
+ *        мощности: элементы ищутся двоичным поиском с последней найденной
+ *        позиции, при пустом промежуточном результате работа прекращается
+ *
+ * @tparam Set тип множества (отсортированный массив)
+ * @param first самое маленькое множество
+ * @param sets указатели на остальные множества
+ * @param begin индекс первого множества
+ * @param end индекс за последним множеством
+ * @return Set пересечение множества first и множеств sets[begin..end)
+ */
+template<typename Set>
+Set intersectSortedSets(const Set &first, const std::vector<const Set *> &sets, size_t begin, size_t end) {
+	Set result(first.begin(), first.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	
+	for (size_t i = begin; i < end && !result.empty(); i++) {
+		const Set &other = *sets[i];
+		size_t from = 0;
+		size_t kept = 0;
+		for (size_t j = 0; j < result.size(); j++) {
+			from = gallopingLowerBound(other.data(), from, other.size(), result[j]);
+			if (from == other.size()) {
+				break;
+			}
+			if (other[from] == result[j]) {
+				result[kept++] = result[j];
+			}
+		}
+		result.resize(kept);
+	}
+	
+	return result;
+}
+
+/**
+ * @brief Применение функции к отрезкам [0; n) в параллельных потоках
+ *
+ * @tparam Set тип множества
+ * @tparam Chunk функция (начало, конец) -> множество
+ * @param n длина
+ * @param chunk функция обработки отрезка
+ * @return std::vector<Set> результаты по отрезкам
+ */
+template<typename Set, typename Chunk>
+std::vector<Set> processInChunks(size_t n, Chunk chunk) {
+	size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+	size_t chunkSize = (n + threads - 1) / threads;
+	
+	std::vector<Set> parts((n + chunkSize - 1) / chunkSize);
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < parts.size(); i++) {
+		workers.emplace_back([&parts, &chunk, i, chunkSize, n]() {
+			OperationTimer timer("processInChunks", std::min(n, (i + 1) * chunkSize) - i * chunkSize);
+			parts[i] = chunk(i * chunkSize, std::min(n, (i + 1) * chunkSize));
+		});
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+	
+	return parts;
+}
+
+/**
+ * @brief Параллельная попарная редукция: пары частей сводятся одновременно
+ *        в разных потоках, пока не останется одна часть
+ *
+ * @tparam Set тип множества
+ * @tparam Reduce функция (множество, множество) -> множество
+ * @param parts части
+ * @param reduce функция сведения двух частей
+ * @return Set результат редукции
+ */
+template<typename Set, typename Reduce>
+Set parallelTreeReduce(std::vector<Set> parts, Reduce reduce) {
+	if (parts.empty()) {
+		return Set();
+	}
+	
+	while (parts.size() > 1) {
+		std::vector<Set> next((parts.size() + 1) / 2);
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i + 1 < parts.size(); i += 2) {
+			workers.emplace_back([&parts, &next, &reduce, i]() {
+				OperationTimer timer("parallelTreeReduce", parts[i].size() + parts[i + 1].size());
+				next[i / 2] = reduce(parts[i], parts[i + 1]);
+			});
+		}
+		if (parts.size() % 2 == 1) {
+			next.back() = std::move(parts.back());
+		}
+		for (std::thread &worker : workers) {
+			worker.join();
+		}
+		parts = std::move(next);
+	}
+	
+	return std::move(parts.front());
+}
+
+/**
+ * @brief Объединение отсортированных множеств: k-путевое слияние, при
+ *        большом числе множеств - слияние групп в разных потоках и
+ *        параллельная попарная редукция результатов
+ */
+template<typename Set>
+Set uniteSortedSets(const std::vector<const Set *> &sets) {
+	if (sets.size() < PARALLEL_SETS_THRESHOLD) {
+		return mergeSortedSets(sets, 0, sets.size());
+	}
+	
+	std::vector<Set> parts = processInChunks<Set>(sets.size(), [&sets](size_t begin, size_t end) {
+		return mergeSortedSets(sets, begin, end);
+	});
+	return parallelTreeReduce(std::move(parts), [](const Set &x, const Set &y) {
+		Set result;
+		result.reserve(x.size() + y.size());
+		std::set_union(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result));
+		return result;
+	});
+}
+
+/**
+ * @brief Пересечение отсортированных множеств от меньших к большим с досрочным
+ *        выходом, при большом числе множеств - группами в разных потоках
+ */
+template<typename Set>
+Set intersectSortedSets(std::vector<const Set *> sets) {
+	if (sets.empty()) {
+		return Set();
+	}
+	std::sort(sets.begin(), sets.end(), [](const Set *x, const Set *y) {
+		return x->size() < y->size();
+	});
+	
+	if (sets.size() < PARALLEL_SETS_THRESHOLD) {
+		return intersectSortedSets(*sets.front(), sets, 1, sets.size());
+	}
+	
+	// Каждая группа начинает с самого маленького множества, чтобы быстро сужаться
+	std::vector<Set> parts = processInChunks<Set>(sets.size() - 1, [&sets](size_t begin, size_t end) {
+		return intersectSortedSets(*sets.front(), sets, begin + 1, end + 1);
+	});
+	return parallelTreeReduce(std::move(parts), [](const Set &x, const Set &y) {
+		Set result;
+		std::set_intersection(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result));
+		return result;
+	});
+}
+
+/**
+ * @brief Объединение произвольного числа множеств
+ *
+ * @tparam T тип элементов множества
+ * @param sets множества
+ * @return std::vector<T> мн-во, являющееся объединением всех множеств
+ */
+template<typename T>
+std::vector<T> uniteAll(std::vector< std::vector<T> > sets) {
+	std::vector<const std::vector<T> *> pointers;
+	pointers.reserve(sets.size());
+	for (std::vector<T> &x : sets) {
+		std::sort(x.begin(), x.end());
+		pointers.push_back(&x);
+	}
+	
+	return uniteSortedSets(pointers);
+}
+
+/**
+ * @brief Пересечение произвольного числа множеств
+ *
+ * @tparam T тип элементов множества
+ * @param sets множества
+ * @return std::vector<T> мн-во, являющееся пересечением всех множеств
+ */
+template<typename T>
+std::vector<T> intersectAll(std::vector< std::vector<T> > sets) {
+	std::vector<const std::vector<T> *> pointers;
+	pointers.reserve(sets.size());
+	for (std::vector<T> &x : sets) {
+		std::sort(x.begin(), x.end());
+		pointers.push_back(&x);
+	}
+	
+	return intersectSortedSets(pointers);
+}
+
+// Разброс значений на один элемент, до которого проекция идёт через битовую карту
+const size_t PROJECTION_BITMAP_SPAN_PER_ELEMENT = 64;
+// Начиная с этого числа пар проекция строится в несколько потоков
+const size_t PARALLEL_PROJECTION_THRESHOLD = 1 << 20;
+
+/**
+ * @brief Наименьшее и наибольшее значения непустого массива. На x86 проход
+ *        идёт по 4 значения в регистре SSE2
+ *
+ * @param values массив
+ * @param n длина массива
+ * @return std::pair<int, int> наименьшее и наибольшее значения
+ */
+std::pair<int, int> valueBounds(const int *values, size_t n) {
+	int low = values[0], high = values[0];
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	if (n >= 4) {
+		__m128i lows = _mm_loadu_si128((const __m128i *)values), highs = lows;
+		for (i = 4; i + 4 <= n; i += 4) {
+			__m128i current = _mm_loadu_si128((const __m128i *)(values + i));
+			// В SSE2 нет знакового минимума 32-битных чисел: выбор по маске сравнения
+			__m128i less = _mm_cmplt_epi32(current, lows);
+			lows = _mm_or_si128(_mm_and_si128(less, current), _mm_andnot_si128(less, lows));
+			__m128i greater = _mm_cmpgt_epi32(current, highs);
+			highs = _mm_or_si128(_mm_and_si128(greater, current), _mm_andnot_si128(greater, highs));
+		}
+		
+		int lanes[4];
+		_mm_storeu_si128((__m128i *)lanes, lows);
+		low = *std::min_element(lanes, lanes + 4);
+		_mm_storeu_si128((__m128i *)lanes, highs);
+		high = *std::max_element(lanes, lanes + 4);
+	}
+#endif
+
+	for (; i < n; i++) {
+		low = std::min(low, values[i]);
+		high = std::max(high, values[i]);
+	}
+	
+	return {low, high};
+}
+
+/**
+ * @brief Различные значения массива в порядке возрастания за линейное время:
+ *        при небольшом разбросе значений - через битовую карту, иначе -
+ *        поразрядной сортировкой (LSD, по байту за проход, только по байтам
+ *        разброса) с удалением повторов
+ *
+ * @param values значения (порядок не важен, массив портится)
+ * @return IntVector различные значения по возрастанию
+ */
+IntVector sortUnique(IntVector values) {
+	if (values.empty()) {
+		return values;
+	}
+	
+	std::pair<int, int> bounds = valueBounds(values.data(), values.size());
+	uint32_t base = (uint32_t)bounds.first;
+	uint32_t span = (uint32_t)bounds.second - base;
+	
+	if (span / PROJECTION_BITMAP_SPAN_PER_ELEMENT <= values.size()) {
+		std::vector<uint64_t> bits(span / 64 + 1, 0);
+		for (int value : values) {
+			uint32_t offset = (uint32_t)value - base;
+			bits[offset / 64] |= uint64_t(1) << (offset % 64);
+		}
+		
+		size_t count = 0;
+		for (size_t w = 0; w < bits.size(); w++) {
+			for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+				values[count++] = (int)(base + (uint32_t)(w * 64 + (size_t)__builtin_ctzll(word)));
+			}
+		}
+		values.resize(count);
+		return values;
+	}
+	
+	// Сортируются смещения от минимума: старшие нулевые байты разброса пропускаются
+	std::vector<uint32_t> keys(values.size()), buffer(values.size());
+	for (size_t i = 0; i < values.size(); i++) {
+		keys[i] = (uint32_t)values[i] - base;
+	}
+	for (uint32_t shift = 0; shift < 32 && (span >> shift) != 0; shift += 8) {
+		size_t counts[256] = {};
+		for (uint32_t key : keys) {
+			counts[(key >> shift) & 0xFF]++;
+		}
+		size_t position = 0;
+		for (size_t &count : counts) {
+			size_t current = count;
+			count = position;
+			position += current;
+		}
+		for (uint32_t key : keys) {
+			buffer[counts[(key >> shift) & 0xFF]++] = key;
+		}
+		keys.swap(buffer);
+	}
+	
+	size_t count = 0;
+	for (size_t i = 0; i < keys.size(); i++) {
+		if (i == 0 || keys[i] != keys[i - 1]) {
+			values[count++] = (int)(base + keys[i]);
+		}
+	}
+	values.resize(count);
+	return values;
+}
+
+/**
+ * @brief Проекция графика на один из элементов пары: столбец извлекается и
+ *        очищается от повторов функцией sortUnique. Большие графики делятся
+ *        на части, проекции частей строятся в разных потоках и сливаются
+ *        параллельной попарной редукцией
+ *
+ * @param g график
+ * @param column проецируемый элемент пары (&std::pair<int, int>::first или ::second)
+ * @return IntVector различные значения элемента по возрастанию
+ */
+template<typename Allocator>
+IntVector projection(const std::vector< std::pair<int, int>, Allocator > &g, int std::pair<int, int>::*column) {
+	OperationTimer timer("projection", g.size());
+	auto project = [&g, column](size_t begin, size_t end) {
+		IntVector values(currentMemoryResource);
+		values.reserve(end - begin);
+		for (size_t i = begin; i < end; i++) {
+			values.push_back(g[i].*column);
+		}
+		return sortUnique(std::move(values));
+	};
+	
+	if (g.size() < PARALLEL_PROJECTION_THRESHOLD) {
+		return project(0, g.size());
+	}
+	
+	std::vector<IntVector> parts = processInChunks<IntVector>(g.size(), project);
+	return parallelTreeReduce(std::move(parts), [](const IntVector &x, const IntVector &y) {
+		IntVector result(currentMemoryResource);
+		result.reserve(x.size() + y.size());
+		std::set_union(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(result));
+		return result;
+	});
+}
+
+// Начиная с этой длины массив сортируется в несколько потоков
+const size_t PARALLEL_SORT_THRESHOLD = 1 << 16;
+
+/**
+ * @brief Группа потоков, которые дожидаются в деструкторе: если запустивший
+ *        их код выйдет по исключению, потоки не останутся подключаемыми
+ *        (уничтожение подключаемого std::thread вызывает std::terminate)
+ */
+class ThreadGroup {
+private:
+	std::vector<std::thread> threads;
+public:
+	ThreadGroup() = default;
+	
+	ThreadGroup(const ThreadGroup &) = delete;
+	ThreadGroup &operator=(const ThreadGroup &) = delete;
+	
+	~ThreadGroup() {
+		this->join();
+	}
+	
+	template<typename Work>
+	void run(Work work) {
+		this->threads.emplace_back(std::move(work));
+	}
+	
+	void join() {
+		for (std::thread &thread : this->threads) {
+			if (thread.joinable()) {
+				thread.join();
+			}
+		}
+		this->threads.clear();
+	}
+};
+
+/**
+ * @brief Запуск work(0), ..., work(count - 1) в отдельных потоках с ожиданием
+ *        их завершения
+ */
+template<typename Work>
+void runInThreads(size_t count, Work work) {
+	ThreadGroup workers;
+	for (size_t i = 0; i < count; i++) {
+		workers.run([&work, i]() {
+			work(i);
+		});
+	}
+	workers.join();
+}
+
+/**
+ * @brief Параллельная сортировка выборкой (sample sort):
+ *        1) по равномерной выборке выбираются границы корзин, по корзине на поток;
+ *        2) каждый поток считает, сколько элементов его отрезка попадает в каждую корзину;
+ *        3) по префиксным суммам потоки раскладывают свои элементы по корзинам
+ *           во вспомогательный буфер без синхронизации;
+ *        4) корзины сортируются независимо.
+ *        Результат совпадает с std::sort: равные элементы неразличимы
+ *
+ * @param v массив (pmr-вектор: буфер размещается в его источнике памяти)
+ */
+template<typename Vector>
+void parallelSort(Vector &v) {
+	using T = typename Vector::value_type;
+	// Выборка по OVERSAMPLING элементов на корзину, внутри шага позиция сдвигается,
+	// чтобы не попадать в период входных данных. Корзин не больше n / OVERSAMPLING,
+	// иначе шаг выборки был бы нулевым
+	const size_t OVERSAMPLING = 64;
+	const size_t n = v.size();
+	const size_t threads = std::min<size_t>(std::max<size_t>(1, std::thread::hardware_concurrency()),
+	                                        n / OVERSAMPLING);
+	if (n < PARALLEL_SORT_THRESHOLD || threads <= 1) {
+		std::sort(v.begin(), v.end());
+		return;
+	}
+	
+	const size_t sampleSize = threads * OVERSAMPLING, step = n / sampleSize;
+	std::vector<T> sample(sampleSize);
+	for (size_t i = 0; i < sampleSize; i++) {
+		sample[i] = v[i * step + (size_t)(Fingerprint::mix(i, 0) % step)];
+	}
+	std::sort(sample.begin(), sample.end());
+	std::vector<T> splitters;
+	for (size_t b = 1; b < threads; b++) {
+		splitters.push_back(sample[b * OVERSAMPLING]);
+	}
+	auto bucket = [&splitters](const T &x) {
+		return (size_t)(std::upper_bound(splitters.begin(), splitters.end(), x) - splitters.begin());
+	};
+	
+	const size_t chunk = (n + threads - 1) / threads;
+	std::vector< std::vector<size_t> > positions(threads, std::vector<size_t>(threads, 0));
+	runInThreads(threads, [&](size_t t) {
+		for (size_t i = t * chunk; i < std::min(n, (t + 1) * chunk); i++) {
+			positions[t][bucket(v[i])]++;
+		}
+	});
+	
+	// Корзина b начинается после всех меньших корзин, внутри неё - отрезки потоков по порядку
+	std::vector<size_t> bucketStart(threads + 1, 0);
+	size_t offset = 0;
+	for (size_t b = 0; b < threads; b++) {
+		bucketStart[b] = offset;
+		for (size_t t = 0; t < threads; t++) {
+			size_t count = positions[t][b];
+			positions[t][b] = offset;
+			offset += count;
+		}
+	}
+	bucketStart[threads] = n;
+	
+	Vector buffer(n, v.get_allocator());
+	runInThreads(threads, [&](size_t t) {
+		std::vector<size_t> &next = positions[t];
+		for (size_t i = t * chunk; i < std::min(n, (t + 1) * chunk); i++) {
+			buffer[next[bucket(v[i])]++] = v[i];
+		}
+	});
+	runInThreads(threads, [&](size_t b) {
+		std::sort(buffer.begin() + (ptrdiff_t)bucketStart[b], buffer.begin() + (ptrdiff_t)bucketStart[b + 1]);
+	});
+	
+	v.swap(buffer);
+}
+
+/**
+ * @brief Символьное (нематериализованное) множество целых чисел. Множества,
+ *        заданные высказыванием (арифметические прогрессии и квадраты на
+ *        промежутке), хранятся своими параметрами: принадлежность и мощность
+ *        вычисляются за O(1), элементы порождаются только в materialize().
+ *        Явно заданные множества хранятся в самом компактном из видов:
+ *        отсортированный массив, битовая карта или список отрезков
+ */
+class SymbolicSet {
+public:
+	enum class Kind {
+		Explicit,    // явно перечисленные элементы (отсортированы, без повторов)
+		Progression, // first, first + step, ..., first + step * (count - 1)
+		Squares,     // квадраты чисел rootLow, ..., rootHigh (0 <= rootLow)
+		Intervals,   // отсортированный список непересекающихся несоседних отрезков [l;r]
+		Union,       // ленивое объединение двух символьных множеств
+		Bitmap       // битовая карта на [bitmapBase; bitmapBase + 64 * bits.size())
+	};
+	
+	using Interval = std::pair<long long, long long>;
+	
+	// Наибольшее число, квадрат которого помещается в int
+	static constexpr long long MAX_ROOT = 46340;
+	
+	SymbolicSet() = default;
+	
+	/**
+	 * @brief Множество из явно заданных элементов
+	 *
+	 * @param elements элементы (порядок и повторы не важны)
+	 */
+	explicit SymbolicSet(std::vector<int> elements)
+			: elements(std::move(elements)) {
+		std::sort(this->elements.begin(), this->elements.end());
+		this->elements.erase(std::unique(this->elements.begin(), this->elements.end()), this->elements.end());
+		this->cardinality = this->elements.size();
+		this->chooseRepresentation();
+	}
+	
+	/**
+	 * @brief Числа промежутка [a;b], сравнимые с residue по модулю step.
+	 *        Промежуток обрезается до [INT_MIN; INT_MAX], как квадраты в
+	 *        squares(): элементы порождаются как int, а вычисления первого
+	 *        члена и мощности остаются без переполнения long long
+	 */
+	static SymbolicSet progression(long long a, long long b, long long step = 1, long long residue = 0) {
+		a = std::max<long long>(a, INT_MIN);
+		b = std::min<long long>(b, INT_MAX);
+		SymbolicSet s;
+		s.kind = Kind::Progression;
+		s.step = step;
+		s.first = a + (((residue - a) % step) + step) % step;
+		s.count = (s.first > b) ? 0 : (b - s.first) / step + 1;
+		s.cardinality = (size_t)s.count;
+		return s;
+	}
+	
+	/**
+	 * @brief Квадраты чисел промежутка [a;b]. Квадраты, не помещающиеся в int,
+	 *        отбрасываются (раньше они молча переполнялись)
+	 */
+	static SymbolicSet squares(long long a, long long b) {
+		SymbolicSet s;
+		s.kind = Kind::Squares;
+		if (a > b) {
+			s.rootLow = 1;
+			s.rootHigh = 0;
+		} else if (a <= 0 && 0 <= b) {
+			s.rootLow = 0;
+			s.rootHigh = std::max(-a, b);
+		} else if (b < 0) {
+			s.rootLow = -b;
+			s.rootHigh = -a;
+		} else {
+			s.rootLow = a;
+			s.rootHigh = b;
+		}
+		s.rootHigh = std::min(s.rootHigh, MAX_ROOT);
+		s.cardinality = (s.rootLow > s.rootHigh) ? 0 : (size_t)(s.rootHigh - s.rootLow + 1);
+		return s;
+	}
+	
+	[[nodiscard]] Kind getKind() const {
+		return this->kind;
+	}
+	
+	/**
+	 * @brief Мощность множества, O(1). Исключение - первый вызов у ленивого
+	 *        объединения: мощность считается по формуле включений-исключений
+	 *        через пересечение операндов, а для видов без символьного
+	 *        пересечения оно перебирает меньший операнд. Результат
+	 *        запоминается, поэтому множество не опрашивается одновременно
+	 *        из нескольких потоков
+	 */
+	[[nodiscard]] size_t size() const {
+		if (!this->cardinalityExact) {
+			this->cardinality = this->left->size() + this->right->size() -
+			                    intersect(*this->left, *this->right).size();
+			this->cardinalityExact = true;
+		}
+		return this->cardinality;
+	}
+	
+	/**
+	 * @brief Верхняя оценка мощности без вычислений, O(1). Точна для всех
+	 *        видов, кроме ещё не посчитанного ленивого объединения
+	 */
+	[[nodiscard]] size_t sizeBound() const {
+		return this->cardinality;
+	}
+	
+	/**
+	 * @brief Проверка принадлежности элемента множеству, O(1) для
+	 *        символьных множеств и O(log n) для явно заданных
+	 */
+	[[nodiscard]] bool contains(long long v) const {
+		switch (this->kind) {
+			case Kind::Explicit:
+				return std::binary_search(this->elements.begin(), this->elements.end(), v,
+				                          [](long long x, long long y) { return x < y; });
+			case Kind::Progression:
+				return this->count > 0 && this->first <= v && v <= this->last() &&
+				       (v - this->first) % this->step == 0;
+			case Kind::Squares: {
+				if (v < 0 || this->rootLow > this->rootHigh) {
+					return false;
+				}
+				long long r = integerSqrt(v);
+				return r * r == v && this->rootLow <= r && r <= this->rootHigh;
+			}
+			case Kind::Intervals: {
+				auto it = std::upper_bound(this->intervals.begin(), this->intervals.end(), v,
+				                           [](long long e, const Interval &i) { return e < i.first; });
+				return it != this->intervals.begin() && std::prev(it)->second >= v;
+			}
+			case Kind::Union:
+				return this->left->contains(v) || this->right->contains(v);
+			case Kind::Bitmap:
+				return this->testBit(v);
+		}
+		return false;
+	}
+	
+	/**
+	 * @brief Дописывает элементы множества в порядке возрастания в конец массива
+	 *
+	 * @param result массив
+	 */
+	template<typename Allocator>
+	void appendTo(std::vector<int, Allocator> &result) const {
+		result.reserve(result.size() + this->cardinality);
+		switch (this->kind) {
+			case Kind::Explicit:
+				result.insert(result.end(), this->elements.begin(), this->elements.end());
+				break;
+			case Kind::Progression:
+				for (long long i = 0; i < this->count; i++) {
+					result.push_back((int)(this->first + i * this->step));
+				}
+				break;
+			case Kind::Squares:
+				for (long long r = this->rootLow; r <= this->rootHigh; r++) {
+					result.push_back((int)(r * r));
+				}
+				break;
+			case Kind::Intervals:
+				for (const Interval &i : this->intervals) {
+					for (long long v = i.first; v <= i.second; v++) {
+						result.push_back((int)v);
+					}
+				}
+				break;
+			case Kind::Bitmap:
+				for (size_t w = 0; w < this->bits.size(); w++) {
+					for (uint64_t word = this->bits[w]; word != 0; word &= word - 1) {
+						result.push_back((int)(this->bitmapBase + 64 * (long long)w + __builtin_ctzll(word)));
+					}
+				}
+				break;
+			case Kind::Union: {
+				std::vector<int> l = this->left->materialize();
+				std::vector<int> r = this->right->materialize();
+				std::set_union(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(result));
+			}
+				break;
+		}
+	}
+	
+	/**
+	 * @brief Порождение элементов множества
+	 *
+	 * @return std::vector<int> отсортированные элементы без повторов
+	 */
+	[[nodiscard]] std::vector<int> materialize() const {
+		std::vector<int> result;
+		this->appendTo(result);
+		return result;
+	}
+	
+	friend SymbolicSet intersect(const SymbolicSet &x, const SymbolicSet &y);
+	friend SymbolicSet unite(const SymbolicSet &x, const SymbolicSet &y);
+
+private:
+	Kind kind = Kind::Explicit;
+	mutable size_t cardinality = 0;
+	mutable bool cardinalityExact = true; // false - в cardinality только оценка сверху
+	std::vector<int> elements;
+	long long first = 0, step = 1, count = 0;
+	long long rootLow = 1, rootHigh = 0;
+	std::vector<Interval> intervals;
+	long long bitmapBase = 0;
+	std::vector<uint64_t> bits;
+	std::shared_ptr<const SymbolicSet> left, right;
+	
+	/**
+	 * @brief Выбор представления явно заданного множества (elements уже
+	 *        отсортирован): самое компактное из массива (4 байта на элемент),
+	 *        битовой карты (1 бит на значение разброса) и списка отрезков
+	 *        (16 байт на отрезок). Маленькие множества остаются массивом
+	 */
+	void chooseRepresentation() {
+		const std::vector<int> &e = this->elements;
+		if (e.size() <= 8) {
+			return;
+		}
+		
+		size_t runs = 1;
+		for (size_t i = 1; i < e.size(); i++) {
+			runs += (e[i] != e[i - 1] + 1) ? 1 : 0;
+		}
+		long long base = (e.front() >= 0) ? e.front() / 64 * 64 : -((-(long long)e.front() + 63) / 64 * 64);
+		unsigned long long words = (unsigned long long)((long long)e.back() - base) / 64 + 1;
+		
+		unsigned long long vectorBytes = 4ULL * e.size();
+		unsigned long long bitmapBytes = 8ULL * words;
+		unsigned long long intervalBytes = 16ULL * runs;
+		
+		if (intervalBytes <= vectorBytes && intervalBytes <= bitmapBytes) {
+			this->kind = Kind::Intervals;
+			for (int v : e) {
+				if (!this->intervals.empty() && this->intervals.back().second + 1 == v) {
+					this->intervals.back().second = v;
+				} else {
+					this->intervals.emplace_back(v, v);
+				}
+			}
+		} else if (bitmapBytes < vectorBytes) {
+			this->kind = Kind::Bitmap;
+			this->bitmapBase = base;
+			this->bits.assign((size_t)words, 0);
+			for (int v : e) {
+				this->bits[(size_t)((v - base) / 64)] |= uint64_t(1) << ((v - base) % 64);
+			}
+		} else {
+			return;
+		}
+		this->elements = std::vector<int>();
+	}
+	
+	[[nodiscard]] bool testBit(long long v) const {
+		if (v < this->bitmapBase || v >= this->bitmapBase + 64 * (long long)this->bits.size()) {
+			return false;
+		}
+		return (this->bits[(size_t)((v - this->bitmapBase) / 64)] >> ((v - this->bitmapBase) % 64)) & 1;
+	}
+	
+	/**
+	 * @brief Пословная операция над двумя битовыми картами
+	 *
+	 * @tparam Operation операция над словами
+	 */
+	template<typename Operation>
+	static SymbolicSet combineBitmaps(const SymbolicSet &x, const SymbolicSet &y, Operation operation) {
+		SymbolicSet result;
+		result.kind = Kind::Bitmap;
+		result.bitmapBase = std::min(x.bitmapBase, y.bitmapBase);
+		long long end = std::max(x.bitmapBase + 64 * (long long)x.bits.size(),
+		                         y.bitmapBase + 64 * (long long)y.bits.size());
+		result.bits.resize((size_t)((end - result.bitmapBase) / 64));
+		auto word = [](const SymbolicSet &s, long long position) -> uint64_t {
+			long long index = (position - s.bitmapBase) / 64;
+			return (position < s.bitmapBase || index >= (long long)s.bits.size()) ? 0 : s.bits[(size_t)index];
+		};
+		
+		for (size_t w = 0; w < result.bits.size(); w++) {
+			long long position = result.bitmapBase + 64 * (long long)w;
+			result.bits[w] = operation(word(x, position), word(y, position));
+			result.cardinality += (size_t)__builtin_popcountll(result.bits[w]);
+		}
+		return result;
+	}
+	
+	/**
+	 * @brief Является ли множество сплошным набором отрезков (прогрессия с шагом 1
+	 *        или список отрезков)
+	 */
+	[[nodiscard]] bool isIntervalList() const {
+		return this->kind == Kind::Intervals || (this->kind == Kind::Progression && this->step == 1);
+	}
+	
+	[[nodiscard]] std::vector<Interval> getIntervals() const {
+		if (this->kind == Kind::Intervals) {
+			return this->intervals;
+		}
+		std::vector<Interval> result;
+		if (this->count > 0) {
+			result.emplace_back(this->first, this->last());
+		}
+		return result;
+	}
+	
+	/**
+	 * @brief Поэлементная операция над двумя списками отрезков за один проход
+	 *        по их границам, O(количество отрезков)
+	 *
+	 * @tparam Operation функция (принадлежит a, принадлежит b) -> принадлежит результату
+	 */
+	template<typename Operation>
+	static SymbolicSet combineIntervals(const std::vector<Interval> &a, const std::vector<Interval> &b,
+	                                    Operation operation) {
+		SymbolicSet result;
+		result.kind = Kind::Intervals;
+		size_t i = 0, j = 0;
+		bool inA = false, inB = false, inResult = false;
+		long long start = 0;
+		
+		// Отрезок [l;r] даёт события l и r + 1
+		while (i < a.size() || j < b.size()) {
+			long long nextA = (i < a.size()) ? (inA ? a[i].second + 1 : a[i].first) : 0;
+			long long nextB = (j < b.size()) ? (inB ? b[j].second + 1 : b[j].first) : 0;
+			long long point = (i < a.size() && (j >= b.size() || nextA <= nextB)) ? nextA : nextB;
+			
+			if (i < a.size() && nextA == point) {
+				i += inA ? 1 : 0;
+				inA = !inA;
+			}
+			if (j < b.size() && nextB == point) {
+				j += inB ? 1 : 0;
+				inB = !inB;
+			}
+			
+			bool now = operation(inA, inB);
+			if (now && !inResult) {
+				start = point;
+			} else if (!now && inResult) {
+				if (!result.intervals.empty() && result.intervals.back().second + 1 >= start) {
+					result.intervals.back().second = point - 1;
+				} else {
+					result.intervals.emplace_back(start, point - 1);
+				}
+				result.cardinality += (size_t)(point - start);
+			}
+			inResult = now;
+		}
+		
+		return result;
+	}
+	
+	[[nodiscard]] long long last() const {
+		return this->first + this->step * (this->count - 1);
+	}
+	
+	static long long integerSqrt(long long v) {
+		long long r = (long long)std::sqrt((double)v);
+		while (r * r > v) {
+			--r;
+		}
+		while ((r + 1) * (r + 1) <= v) {
+			++r;
+		}
+		return r;
+	}
+	
+	/**
+	 * @brief Расширенный алгоритм Евклида: a*x + b*y = gcd(a, b)
+	 */
+	static long long extendedGcd(long long a, long long b, long long &x, long long &y) {
+		if (b == 0) {
+			x = 1;
+			y = 0;
+			return a;
+		}
+		long long x1, y1;
+		long long g = extendedGcd(b, a % b, x1, y1);
+		x = y1;
+		y = x1 - (a / b) * y1;
+		return g;
+	}
+	
+	/**
+	 * @brief Отбор элементов, принадлежащих множеству filter, из множества source
+	 */
+	static SymbolicSet filter(const SymbolicSet &source, const SymbolicSet &filter) {
+		std::vector<int> result;
+		for (int v : source.materialize()) {
+			if (filter.contains(v)) {
+				result.push_back(v);
+			}
+		}
+		return SymbolicSet(std::move(result));
+	}
+};
+
+/**
+ * @brief Пересечение символьных множеств. Пересечение прогрессий (по
+ *        китайской теореме об остатках), списков отрезков и квадратов
+ *        вычисляется символьно, в остальных случаях перебирается меньшее
+ *        множество
+ *
+ * @param x первое множество
+ * @param y второе множество
+ * @return SymbolicSet пересечение множеств x и y
+ */
+SymbolicSet intersect(const SymbolicSet &x, const SymbolicSet &y) {
+	using Kind = SymbolicSet::Kind;
+	
+	if (x.kind == Kind::Progression && y.kind == Kind::Progression) {
+		if (x.count == 0 || y.count == 0) {
+			return SymbolicSet::progression(1, 0);
+		}
+		long long p, q;
+		long long g = SymbolicSet::extendedGcd(x.step, y.step, p, q);
+		long long delta = y.first - x.first;
+		if (delta % g != 0) {
+			return SymbolicSet::progression(1, 0);
+		}
+		long long m = y.step / g;
+		long long k = ((delta / g) % m * (p % m)) % m; // x.first + x.step * k ≡ y.first (mod y.step)
+		long long lcm = x.step / g * y.step;
+		long long residue = ((x.first + x.step * k) % lcm + lcm) % lcm;
+		return SymbolicSet::progression(std::max(x.first, y.first), std::min(x.last(), y.last()),
+		                                lcm, residue);
+	}
+	if (x.isIntervalList() && y.isIntervalList()) {
+		return SymbolicSet::combineIntervals(x.getIntervals(), y.getIntervals(),
+		                                     [](bool a, bool b) { return a && b; });
+	}
+	if (x.kind == Kind::Squares && y.kind == Kind::Squares) {
+		SymbolicSet s;
+		s.kind = Kind::Squares;
+		s.rootLow = std::max(x.rootLow, y.rootLow);
+		s.rootHigh = std::min(x.rootHigh, y.rootHigh);
+		s.cardinality = (s.rootLow > s.rootHigh) ? 0 : (size_t)(s.rootHigh - s.rootLow + 1);
+		return s;
+	}
+	
+	if (x.kind == Kind::Bitmap && y.kind == Kind::Bitmap) {
+		return SymbolicSet::combineBitmaps(x, y, [](uint64_t a, uint64_t b) { return a & b; });
+	}
+	
+	return (x.sizeBound() <= y.sizeBound()) ? SymbolicSet::filter(x, y) : SymbolicSet::filter(y, x);
+}
+
+/**
+ * @brief Объединение символьных множеств. Перекрывающиеся или соседние
+ *        прогрессии с одинаковым шагом и квадраты сливаются символьно,
+ *        сплошные диапазоны - в список отрезков, в остальных случаях
+ *        строится ленивое объединение за O(1). Его мощность считается по
+ *        формуле включений-исключений только при первом вызове size()
+ *
+ * @param x первое множество
+ * @param y второе множество
+ * @return SymbolicSet объединение множеств x и y
+ */
+SymbolicSet unite(const SymbolicSet &x, const SymbolicSet &y) {
+	using Kind = SymbolicSet::Kind;
+	
+	if (x.sizeBound() == 0) {
+		return y;
+	}
+	if (y.sizeBound() == 0) {
+		return x;
+	}
+	if (x.kind == Kind::Progression && y.kind == Kind::Progression && x.step == y.step &&
+	    (y.first - x.first) % x.step == 0 &&
+	    std::max(x.first, y.first) <= std::min(x.last(), y.last()) + x.step) {
+		return SymbolicSet::progression(std::min(x.first, y.first), std::max(x.last(), y.last()),
+		                                x.step, x.first % x.step);
+	}
+	if (x.isIntervalList() && y.isIntervalList()) {
+		return SymbolicSet::combineIntervals(x.getIntervals(), y.getIntervals(),
+		                                     [](bool a, bool b) { return a || b; });
+	}
+	if (x.kind == Kind::Squares && y.kind == Kind::Squares &&
+	    std::max(x.rootLow, y.rootLow) <= std::min(x.rootHigh, y.rootHigh) + 1) {
+		SymbolicSet s = x;
+		s.rootLow = std::min(x.rootLow, y.rootLow);
+		s.rootHigh = std::max(x.rootHigh, y.rootHigh);
+		s.cardinality = (size_t)(s.rootHigh - s.rootLow + 1);
+		return s;
+	}
+	
+	if (x.kind == Kind::Bitmap && y.kind == Kind::Bitmap) {
+		return SymbolicSet::combineBitmaps(x, y, [](uint64_t a, uint64_t b) { return a | b; });
+	}
+	
+	SymbolicSet s;
+	s.kind = Kind::Union;
+	s.left = std::make_shared<const SymbolicSet>(x);
+	s.right = std::make_shared<const SymbolicSet>(y);
+	s.cardinality = x.sizeBound() + y.sizeBound(); // точная мощность - при первом вызове size()
+	s.cardinalityExact = false;
+	return s;
+}
+
+/**
+ * @brief Соответствие
+ *
+ */
+class Accordance {
+private:
+	IntVector departureArea{currentMemoryResource};
+	IntVector arrivalArea{currentMemoryResource};
+	PairVector graph{currentMemoryResource};
+	
+	// Соли частей соответствия в отпечатке
+	static constexpr uint64_t DEPARTURE_SALT = 1, ARRIVAL_SALT = 2, GRAPH_SALT = 3;
+	mutable Fingerprint fingerprint;
+	mutable bool fingerprintReady = false;
+	
+	// Перестановка графика, упорядочивающая его по второму элементу (для
+	// инвертированного вида); общая у копий, так как графики у них равны
+	mutable std::shared_ptr< const std::vector<size_t> > inversionOrder;
+	
+	/**
+	 * @brief Добавление в отсортированный массив target тех элементов
+	 *        отсортированного массива source, которых в нём нет (каждого по
+	 *        разу). Новые элементы вливаются слиянием с конца, поэтому уже
+	 *        лежащие в target элементы не копируются во временный буфер
+	 */
+	template<typename T>
+	void mergeMissing(std::pmr::vector<T> &target, const std::pmr::vector<T> &source, uint64_t salt) {
+		std::pmr::vector<T> missing(currentMemoryResource);
+		size_t position = 0;
+		for (size_t i = 0; i < source.size(); i++) {
+			if (i > 0 && source[i] == source[i - 1]) {
+				continue;
+			}
+			position = gallopingLowerBound(target.data(), position, target.size(), source[i]);
+			if (position == target.size() || !(target[position] == source[i])) {
+				missing.push_back(source[i]);
+			}
+		}
+		if (this->fingerprintReady) {
+			for (const T &element : missing) {
+				this->fingerprint.add(element, salt);
+			}
+		}
+		
+		size_t i = target.size(), j = missing.size();
+		target.resize(target.size() + missing.size());
+		for (size_t k = target.size(); j > 0;) {
+			if (i > 0 && missing[j - 1] < target[i - 1]) {
+				target[--k] = target[--i];
+			} else {
+				target[--k] = missing[--j];
+			}
+		}
+	}
+	
+	/**
+	 * @brief Удаление из массива элементов, не удовлетворяющих условию keep,
+	 *        с сохранением порядка остальных
+	 */
+	template<typename T, typename Keep>
+	void keepIf(std::pmr::vector<T> &target, Keep keep, uint64_t salt) {
+		auto end = std::remove_if(target.begin(), target.end(), [this, &keep, salt](const T &element) {
+			if (keep(element)) {
+				return false;
+			}
+			if (this->fingerprintReady) {
+				this->fingerprint.remove(element, salt);
+			}
+			return true;
+		});
+		target.erase(end, target.end());
+	}
+public:
+	// Признак того, что области и график уже отсортированы
+	struct Sorted {};
+	// Признак массовой загрузки с параллельной сортировкой
+	struct Parallel {};
+	
+	explicit Accordance(
+			const std::vector<int> &departureArea = std::vector<int>(),
+			const std::vector<int> &arrivalArea = std::vector<int>(),
+			const std::vector< std::pair<int, int> > &graph = std::vector< std::pair<int, int> >()
+	)
+			: departureArea(departureArea.begin(), departureArea.end(), currentMemoryResource),
+			  arrivalArea(arrivalArea.begin(), arrivalArea.end(), currentMemoryResource),
+			  graph(graph.begin(), graph.end(), currentMemoryResource) {
+		std::sort(this->departureArea.begin(), this->departureArea.end());
+		std::sort(this->arrivalArea.begin(), this->arrivalArea.end());
+		std::sort(this->graph.begin(), this->graph.end());
+	}
+	
+	/**
+	 * @brief Соответствие с символьно заданными областями отправления и
+	 *        прибытия: области порождаются сразу в отсортированном виде
+	 */
+	Accordance(
+			const SymbolicSet &departureArea,
+			const SymbolicSet &arrivalArea,
+			const std::vector< std::pair<int, int> > &graph
+	)
+			: graph(graph.begin(), graph.end(), currentMemoryResource) {
+		departureArea.appendTo(this->departureArea);
+		arrivalArea.appendTo(this->arrivalArea);
+		std::sort(this->graph.begin(), this->graph.end());
+	}
+	
+	/**
+	 * @brief Конструктор, забирающий буферы промежуточных результатов операций
+	 *        без копирования
+	 */
+	Accordance(IntVector &&departureArea, IntVector &&arrivalArea, PairVector &&graph)
+			: departureArea(std::move(departureArea), currentMemoryResource),
+			  arrivalArea(std::move(arrivalArea), currentMemoryResource),
+			  graph(std::move(graph), currentMemoryResource) {
+		std::sort(this->departureArea.begin(), this->departureArea.end());
+		std::sort(this->arrivalArea.begin(), this->arrivalArea.end());
+		std::sort(this->graph.begin(), this->graph.end());
+	}
+	
+	/**
+	 * @brief Массовая загрузка: конструктор забирает буферы и сортирует их
+	 *        параллельно - график сортировкой выборкой во всех потоках,
+	 *        области одновременно с ним в двух отдельных потоках. Результат
+	 *        совпадает с результатом обычного конструктора
+	 */
+	Accordance(Parallel, IntVector &&departureArea, IntVector &&arrivalArea, PairVector &&graph)
+			: departureArea(std::move(departureArea), currentMemoryResource),
+			  arrivalArea(std::move(arrivalArea), currentMemoryResource),
+			  graph(std::move(graph), currentMemoryResource) {
+		OperationTimer timer("Accordance(Parallel)", this->graph.size());
+		ThreadGroup areas; // дождётся потоков, даже если parallelSort бросит исключение
+		areas.run([this]() {
+			std::sort(this->departureArea.begin(), this->departureArea.end());
+		});
+		areas.run([this]() {
+			std::sort(this->arrivalArea.begin(), this->arrivalArea.end());
+		});
+		parallelSort(this->graph);
+		areas.join();
+	}
+	
+	/**
+	 * @brief Конструктор, забирающий уже отсортированные буферы без повторной
+	 *        сортировки
+	 */
+	Accordance(Sorted, IntVector &&departureArea, IntVector &&arrivalArea, PairVector &&graph)
+			: departureArea(std::move(departureArea), currentMemoryResource),
+			  arrivalArea(std::move(arrivalArea), currentMemoryResource),
+			  graph(std::move(graph), currentMemoryResource) {}
+	
+	/**
+	 * @brief Копия размещается в текущем источнике памяти (в арене, если она
+	 *        активна), а не в источнике памяти оригинала
+	 */
+	Accordance(const Accordance &other)
+			: departureArea(other.departureArea, currentMemoryResource),
+			  arrivalArea(other.arrivalArea, currentMemoryResource),
+			  graph(other.graph, currentMemoryResource),
+			  fingerprint(other.fingerprint), fingerprintReady(other.fingerprintReady),
+			  inversionOrder(std::atomic_load(&other.inversionOrder)) {}
+	
+	Accordance(Accordance &&other) noexcept = default;
+	Accordance &operator=(const Accordance &other) = default;
+	Accordance &operator=(Accordance &&other) = default;
+	
+	explicit Accordance(const std::vector< std::vector<bool> > &matrix) {
+		for (size_t i = 0; i < matrix.size(); i++) {
+			for (size_t j = 0; j < matrix[i].size(); j++) {
+				if (matrix[i][j]) {
+					if (!found(this->departureArea, (int)(1 + i))) {
+						this->departureArea.push_back((int)(1 + i));
+					}
+					if (!found(this->arrivalArea, (int)(1 + j))) {
+						this->arrivalArea.push_back((int)(1 + j));
+					}
+					if (!found(this->graph, {1 + i, 1 + j})) {
+						this->graph.emplace_back(1 + i, 1 + j);
+					}
+				}
+			}
+		}
+		
+		std::sort(this->departureArea.begin(), this->departureArea.end());
+		std::sort(this->arrivalArea.begin(), this->arrivalArea.end());
+		std::sort(this->graph.begin(), this->graph.end());
+	}
+	
+	explicit Accordance(const std::vector< std::vector<int> > &graph) {
+		for (size_t i = 0; i < graph.size(); i++) {
 			if (!found(this->departureArea, (int)(1 + i))) {
 				this->departureArea.push_back((int)(1 + i));
 			}
-			
-			for (size_t j = 0; j < graph[i].size(); j++) {
-				if (!found(this->arrivalArea, graph[i][j])) {
-					this->arrivalArea.push_back(graph[i][j]);
+			
+			for (size_t j = 0; j < graph[i].size(); j++) {
+				if (!found(this->arrivalArea, graph[i][j])) {
+					this->arrivalArea.push_back(graph[i][j]);
+				}
+				if (!found(this->graph, {1 + i, graph[i][j]})) {
+					this->graph.emplace_back(1 + i, graph[i][j]);
+				}
+			}
+		}
+		
+		std::sort(this->departureArea.begin(), this->departureArea.end());
+		std::sort(this->arrivalArea.begin(), this->arrivalArea.end());
+		std::sort(this->graph.begin(), this->graph.end());
+	}
+	
+	/**
+	 * @brief Область отправления соответствия
+	 *
+	 * @return const IntVector& область отправления соответствия
+	 */
+	[[nodiscard]] const IntVector &getDepartureArea() const {
+		return this->departureArea;
+	}
+	
+	/**
+	 * @brief Область прибытия соответствия
+	 *
+	 * @return const IntVector& область прибытия соответствия
+	 */
+	[[nodiscard]] const IntVector &getArrivalArea() const {
+		return this->arrivalArea;
+	}
+	
+	/**
+	 * @brief График соответствия
+	 *
+	 * @return const PairVector& график соответствия
+	 */
+	[[nodiscard]] const PairVector &getGraph() const {
+		return this->graph;
+	}
+	
+	/**
+	 * @brief 128-битный отпечаток содержимого соответствия (областей и
+	 *        графика). Вычисляется при первом обращении и запоминается
+	 *
+	 * @return const Fingerprint& отпечаток
+	 */
+	[[nodiscard]] const Fingerprint &getFingerprint() const {
+		if (!this->fingerprintReady) {
+			Fingerprint result;
+			for (int element : this->departureArea) {
+				result.add(element, DEPARTURE_SALT);
+			}
+			for (int element : this->arrivalArea) {
+				result.add(element, ARRIVAL_SALT);
+			}
+			for (const std::pair<int, int> &element : this->graph) {
+				result.add(element, GRAPH_SALT);
+			}
+			this->fingerprint = result;
+			this->fingerprintReady = true;
+		}
+		return this->fingerprint;
+	}
+	
+	/**
+	 * @brief Перестановка индексов графика, упорядочивающая его по второму
+	 *        элементу (при равных - по первому). Строится при первом обращении
+	 *        и запоминается; параллельные читатели в худшем случае построят её
+	 *        дважды
+	 *
+	 * @return std::shared_ptr<const std::vector<size_t>> перестановка
+	 */
+	[[nodiscard]] std::shared_ptr< const std::vector<size_t> > getInversionOrder() const {
+		std::shared_ptr< const std::vector<size_t> > order = std::atomic_load(&this->inversionOrder);
+		if (!order) {
+			OperationTimer timer("inversionOrder", this->graph.size());
+			std::shared_ptr< std::vector<size_t> > built = std::make_shared< std::vector<size_t> >(this->graph.size());
+			std::iota(built->begin(), built->end(), 0);
+			// При равных вторых элементах сохраняется порядок графика - по первому
+			std::stable_sort(built->begin(), built->end(), [this](size_t i, size_t j) {
+				return this->graph[i].second < this->graph[j].second;
+			});
+			order = built;
+			std::atomic_store(&this->inversionOrder, order);
+		}
+		return order;
+	}
+	
+	/**
+	 * @brief Объединение с соответствием other на месте: недостающие элементы
+	 *        вливаются в уже отсортированные массивы этого соответствия.
+	 *        Результат совпадает с unite(*this, other)
+	 */
+	Accordance &operator|=(const Accordance &other) {
+		OperationTimer timer("operator|=(Accordance)", this->graph.size() + other.graph.size());
+		this->mergeMissing(this->departureArea, other.departureArea, DEPARTURE_SALT);
+		this->mergeMissing(this->arrivalArea, other.arrivalArea, ARRIVAL_SALT);
+		this->mergeMissing(this->graph, other.graph, GRAPH_SALT);
+		this->inversionOrder.reset();
+		return *this;
+	}
+	
+	/**
+	 * @brief Пересечение с соответствием other на месте. Результат совпадает
+	 *        с intersect(*this, other)
+	 */
+	Accordance &operator&=(const Accordance &other) {
+		OperationTimer timer("operator&=(Accordance)", this->graph.size() + other.graph.size());
+		this->keepIf(this->departureArea, [&other](int element) {
+			return sortedContains(other.departureArea.data(), other.departureArea.size(), element);
+		}, DEPARTURE_SALT);
+		this->keepIf(this->arrivalArea, [&other](int element) {
+			return sortedContains(other.arrivalArea.data(), other.arrivalArea.size(), element);
+		}, ARRIVAL_SALT);
+		this->keepIf(this->graph, [&other](const std::pair<int, int> &element) {
+			return sortedContains(other.graph.data(), other.graph.size(), element);
+		}, GRAPH_SALT);
+		this->inversionOrder.reset();
+		return *this;
+	}
+	
+	/**
+	 * @brief Разность с соответствием other на месте: как и в difference(),
+	 *        остаются пары, элементы которых лежат в разностях областей.
+	 *        Результат совпадает с difference(*this, other)
+	 */
+	Accordance &operator-=(const Accordance &other) {
+		OperationTimer timer("operator-=(Accordance)", this->graph.size() + other.graph.size());
+		this->keepIf(this->departureArea, [&other](int element) {
+			return !sortedContains(other.departureArea.data(), other.departureArea.size(), element);
+		}, DEPARTURE_SALT);
+		this->keepIf(this->arrivalArea, [&other](int element) {
+			return !sortedContains(other.arrivalArea.data(), other.arrivalArea.size(), element);
+		}, ARRIVAL_SALT);
+		this->keepIf(this->graph, [this, &other](const std::pair<int, int> &element) {
+			return !sortedContains(other.graph.data(), other.graph.size(), element) &&
+			       sortedContains(this->departureArea.data(), this->departureArea.size(), element.first) &&
+			       sortedContains(this->arrivalArea.data(), this->arrivalArea.size(), element.second);
+		}, GRAPH_SALT);
+		this->inversionOrder.reset();
+		return *this;
+	}
+	
+	/**
+	 * @brief Область определения соответствия
+	 *
+	 * @return IntVector область определения соответствия
+	 */
+	[[nodiscard]] IntVector definitionArea() const {
+		return projection(this->graph, &std::pair<int, int>::first);
+	}
+	
+	/**
+	 * @brief Область значений соответствия
+	 *
+	 * @return IntVector область значений соответствия
+	 */
+	[[nodiscard]] IntVector valueArea() const {
+		return projection(this->graph, &std::pair<int, int>::second);
+	}
+	
+	/**
+	 * @brief Проверка, является ли соответствие всюду определённым
+	 *
+	 * @return true если соответствие является всюду определённым
+	 * @return false если нет
+	 */
+	[[nodiscard]] bool isEverywhereDefined() const {
+		OperationTimer timer("isEverywhereDefined", this->graph.size());
+		return this->definitionArea() == this->departureArea;
+	}
+	
+	/**
+	 * @brief Проверка, является ли соответствие сюръективным
+	 *
+	 * @return true если соответствие является сюръективным
+	 * @return false если нет
+	 */
+	[[nodiscard]] bool isSurjective() const {
+		OperationTimer timer("isSurjective", this->graph.size());
+		return this->valueArea() == this->arrivalArea;
+	}
+	
+	/**
+	 * @brief Проверка, является ли соответствие функциональным
+	 *
+	 * @return true если соответствие является функциональным
+	 * @return false если нет
+	 */
+	[[nodiscard]] bool isFunctional() const {
+		OperationTimer timer("isFunctional", this->graph.size());
+		std::map<int, int> firstCount;
+		
+		for (const std::pair<int, int> &current : this->graph) {
+			++firstCount[current.first];
+		}
+		
+		return std::all_of(firstCount.begin(), firstCount.end(),
+						   [](const std::pair<int, int> &element) {
+			return element.second <= 1;
+		});
+	}
+	
+	/**
+	 * @brief Проверка, является ли соответствие инъективным
+	 *
+	 * @return true если соответствие является инъективным
+	 * @return false если нет
+	 */
+	[[nodiscard]] bool isInjective() const {
+		OperationTimer timer("isInjective", this->graph.size());
+		std::map<int, int> secondCount;
+		
+		for (const std::pair<int, int> &current : this->graph) {
+			++secondCount[current.second];
+		}
+		
+		return std::all_of(secondCount.begin(), secondCount.end(),
+					[](const std::pair<int, int> &element) {
+			return element.second <= 1;
+		});
+	}
+	
+	/**
+	 * @brief Проверка, является ли соответствие отображением X в Y
+	 *
+	 * @return true если соответствие является отображением X в Y
+	 * @return false если нет
+	 */
+	[[nodiscard]] bool isMappingIn() const {
+		OperationTimer timer("isMappingIn", this->graph.size());
+		return this->isEverywhereDefined() && this->isFunctional();
+	}
+	
+	/**
+	 * @brief Проверка, является ли соответствие отображением X на Y
+	 *
+	 * @return true если соответствие является отображением X на Y
+	 * @return false если нет
+	 */
+	[[nodiscard]] bool isMappingTo() const {
+		OperationTimer timer("isMappingTo", this->graph.size());
+		return this->isEverywhereDefined() && this->isFunctional() && this->isSurjective();
+	}
+	
+	/**
+	 * @brief Проверка, является ли соответствие взаимно однозначным
+	 *
+	 * @return true если соответствие является взаимно однозначным
+	 * @return false если нет
+	 */
+	[[nodiscard]] bool isOneToOne() const {
+		OperationTimer timer("isOneToOne", this->graph.size());
+		return this->isFunctional() && this->isInjective();
+	}
+	
+	/**
+	 * @brief Проверка, является ли соответствие биекцией
+	 *
+	 * @return true если соответствие является биекцией
+	 * @return false если нет
+	 */
+	[[nodiscard]] bool isBijection() const {
+		OperationTimer timer("isBijection", this->graph.size());
+		return (this->isEverywhereDefined() && this->isSurjective() &&
+		        this->isFunctional() && this->isInjective());
+	}
+	
+	/**
+	 * @brief Находит образ множества А
+	 *
+	 * @param a множество А
+	 * @return std::vector<int> образ множества А
+	 */
+	std::vector<int> findImage(const std::vector<int> &a) {
+		OperationTimer timer("findImage", a.size());
+		std::vector<int> gammaB;
+		
+		for (const std::pair<int, int> &current : this->graph) {
+			if (found(a, current.first)) {
+				if (!found(gammaB, current.second)) {
+					gammaB.push_back(current.second);
+				}
+			}
+		}
+		
+		return gammaB;
+	}
+	
+	/**
+	 * @brief Находит прообраз множества B
+	 *
+	 * @param b множество B
+	 * @return std::vector<int> прообраз множества B
+	 */
+	std::vector<int> findPrototype(const std::vector<int> &b) {
+		OperationTimer timer("findPrototype", b.size());
+		std::vector<int> gammaMinus1B;
+		
+		for (const std::pair<int, int> &current : this->graph) {
+			if (found(b, current.second)) {
+				if (!found(gammaMinus1B, current.first)) {
+					gammaMinus1B.push_back(current.first);
+				}
+			}
+		}
+		
+		return gammaMinus1B;
+	}
+	
+	/**
+	 * @brief Находит образ символьно заданного множества А за один проход по
+	 *        графику без материализации множества
+	 *
+	 * @param a множество А
+	 * @return std::vector<int> образ множества А
+	 */
+	std::vector<int> findImage(const SymbolicSet &a) {
+		OperationTimer timer("findImage", a.sizeBound());
+		std::vector<int> gammaB;
+		
+		std::unordered_set<int> seen;
+		
+		for (const std::pair<int, int> &current : this->graph) {
+			if (a.contains(current.first) && seen.insert(current.second).second) {
+				gammaB.push_back(current.second);
+			}
+		}
+		
+		return gammaB;
+	}
+	
+	/**
+	 * @brief Находит прообраз символьно заданного множества B
+	 *
+	 * @param b множество B
+	 * @return std::vector<int> прообраз множества B
+	 */
+	std::vector<int> findPrototype(const SymbolicSet &b) {
+		OperationTimer timer("findPrototype", b.sizeBound());
+		std::vector<int> gammaMinus1B;
+		
+		for (const std::pair<int, int> &current : this->graph) {
+			if (b.contains(current.second) &&
+			    (gammaMinus1B.empty() || gammaMinus1B.back() != current.first)) { // график отсортирован по первому элементу
+				gammaMinus1B.push_back(current.first);
+			}
+		}
+		
+		return gammaMinus1B;
+	}
+	
+	friend Accordance uniteAll(const std::vector<Accordance> &xs);
+	friend Accordance intersectAll(const std::vector<Accordance> &xs);
+	friend Accordance unite(const Accordance &x, const Accordance &y);
+	friend Accordance intersect(const Accordance &x, const Accordance &y);
+	friend Accordance difference(const Accordance &x, const Accordance &y);
+	friend Accordance inverse(const Accordance &x);
+	friend Accordance composition(const Accordance &x, const Accordance &y);
+};
+
+/**
+ * @brief Инвертированный вид соответствия: области меняются местами, пары
+ *        графика читаются с переставленными элементами через кэшированную
+ *        перестановку исходного графика, поэтому вид отсортирован так же, как
+ *        график обычного соответствия. Исходное соответствие должно жить
+ *        дольше вида
+ */
+class InvertedAccordance {
+private:
+	const Accordance *base;
+	std::shared_ptr< const std::vector<size_t> > order;
+public:
+	explicit InvertedAccordance(const Accordance &base)
+			: base(&base), order(base.getInversionOrder()) {}
+	
+	/**
+	 * @brief Исходное (неинвертированное) соответствие
+	 *
+	 * @return const Accordance& исходное соответствие
+	 */
+	[[nodiscard]] const Accordance &getBase() const {
+		return *this->base;
+	}
+	
+	[[nodiscard]] const IntVector &getDepartureArea() const {
+		return this->base->getArrivalArea();
+	}
+	
+	[[nodiscard]] const IntVector &getArrivalArea() const {
+		return this->base->getDepartureArea();
+	}
+	
+	[[nodiscard]] const std::vector<size_t> &getOrder() const {
+		return *this->order;
+	}
+	
+	[[nodiscard]] size_t size() const {
+		return this->order->size();
+	}
+	
+	[[nodiscard]] std::pair<int, int> operator[](size_t i) const {
+		return inversion(this->base->getGraph()[(*this->order)[i]]);
+	}
+	
+	/**
+	 * @brief Позиция первой пары вида, первый элемент которой не меньше заданного
+	 */
+	[[nodiscard]] size_t lowerBound(int first) const {
+		return sortedLowerBound(*this, first);
+	}
+	
+	/**
+	 * @brief Материализация графика вида (уже отсортированного)
+	 *
+	 * @return PairVector график инверсии
+	 */
+	[[nodiscard]] PairVector toGraph() const {
+		PairVector result(currentMemoryResource);
+		result.reserve(this->size());
+		for (size_t i = 0; i < this->size(); i++) {
+			result.push_back((*this)[i]);
+		}
+		return result;
+	}
+};
+
+/**
+ * @brief Объединение двух соответствий
+ *
+ * @param x первое соответствие
+ * @param y второе соответствие
+ * @return Accordance соотв-ие, являющееся объединением соответствий X и Y
+ */
+Accordance unite(const Accordance &x, const Accordance &y) {
+	OperationTimer timer("unite(Accordance)", x.getGraph().size() + y.getGraph().size());
+	return Accordance(
+			unite(x.departureArea, y.departureArea),
+			unite(x.arrivalArea, y.arrivalArea),
+			unite(x.graph, y.graph)
+	);
+}
+
+/**
+ * @brief Пересечение двух соответствий
+ *
+ * @param x первое соответствие
+ * @param y второе соответствие
+ * @return Accordance соотв-ие, являющееся пересечением соответствий X и Y
+ */
+Accordance intersect(const Accordance &x, const Accordance &y) {
+	OperationTimer timer("intersect(Accordance)", x.getGraph().size() + y.getGraph().size());
+	return Accordance(
+			intersect(x.departureArea, y.departureArea),
+			intersect(x.arrivalArea, y.arrivalArea),
+			intersect(x.graph, y.graph)
+	);
+}
+
+/**
+ * @brief Объединение, забирающее буферы первого соответствия: X дополняется
+ *        на месте, поэтому накопление вида acc = unite(std::move(acc), next)
+ *        не копирует накопленное соответствие
+ *
+ * @param x первое соответствие (перемещается в результат)
+ * @param y второе соответствие
+ * @return Accordance соотв-ие, являющееся объединением соответствий X и Y
+ */
+Accordance unite(Accordance &&x, const Accordance &y) {
+	x |= y;
+	return std::move(x);
+}
+
+/**
+ * @brief Пересечение, забирающее буферы первого соответствия
+ *
+ * @param x первое соответствие (перемещается в результат)
+ * @param y второе соответствие
+ * @return Accordance соотв-ие, являющееся пересечением соответствий X и Y
+ */
+Accordance intersect(Accordance &&x, const Accordance &y) {
+	x &= y;
+	return std::move(x);
+}
+
+/**
+ * @brief Объединение произвольного числа соответствий за одно k-путевое
+ *        слияние областей и графиков (вместо цепочки попарных объединений)
+ *
+ * @param xs соответствия
+ * @return Accordance соотв-ие, являющееся объединением всех соответствий
+ */
+Accordance uniteAll(const std::vector<Accordance> &xs) {
+	OperationTimer timer("uniteAll(Accordance)", xs.size());
+	std::vector<const IntVector *> departureAreas, arrivalAreas;
+	std::vector<const PairVector *> graphs;
+	for (const Accordance &x : xs) {
+		departureAreas.push_back(&x.departureArea);
+		arrivalAreas.push_back(&x.arrivalArea);
+		graphs.push_back(&x.graph);
+	}
+	
+	return Accordance(uniteSortedSets(departureAreas), uniteSortedSets(arrivalAreas), uniteSortedSets(graphs));
+}
+
+/**
+ * @brief Пересечение произвольного числа соответствий, от меньших к большим
+ *        с досрочным выходом при пустом промежуточном результате
+ *
+ * @param xs соответствия
+ * @return Accordance соотв-ие, являющееся пересечением всех соответствий
+ */
+Accordance intersectAll(const std::vector<Accordance> &xs) {
+	OperationTimer timer("intersectAll(Accordance)", xs.size());
+	std::vector<const IntVector *> departureAreas, arrivalAreas;
+	std::vector<const PairVector *> graphs;
+	for (const Accordance &x : xs) {
+		departureAreas.push_back(&x.departureArea);
+		arrivalAreas.push_back(&x.arrivalArea);
+		graphs.push_back(&x.graph);
+	}
+	
+	return Accordance(intersectSortedSets(departureAreas), intersectSortedSets(arrivalAreas),
+	                  intersectSortedSets(graphs));
+}
+
+/**
+ * @brief Разность двух соответствий
+ *
+ * @param x первое соответствие
+ * @param y второе соответствие
+ * @return Accordance соотв-ие, являющееся разностью соответствий X и Y
+ */
+Accordance difference(const Accordance &x, const Accordance &y) {
+	OperationTimer timer("difference(Accordance)", x.getGraph().size() + y.getGraph().size());
+	Accordance a = Accordance(
+			difference(x.departureArea, y.departureArea),
+			difference(x.arrivalArea, y.arrivalArea),
+			difference(x.graph, y.graph)
+	);
+	
+	for (size_t i = 0; i < a.graph.size(); i++) {
+		if (!found(a.departureArea, a.graph[i].first)) {
+			a.graph.erase(a.graph.begin() + (ptrdiff_t)i);
+			--i;
+		}
+	}
+	for (size_t i = 0; i < a.graph.size(); i++) {
+		if (!found(a.arrivalArea, a.graph[i].second)) {
+			a.graph.erase(a.graph.begin() + (ptrdiff_t)i);
+			--i;
+		}
+	}
+	
+	return a;
+}
+
+/**
+ * @brief Разность, забирающая буферы первого соответствия
+ *
+ * @param x первое соответствие (перемещается в результат)
+ * @param y второе соответствие
+ * @return Accordance соотв-ие, являющееся разностью соответствий X и Y
+ */
+Accordance difference(Accordance &&x, const Accordance &y) {
+	x -= y;
+	return std::move(x);
+}
+
+/**
+ * @brief Инверсия соответствия X
+ *
+ * @param x соответствие X
+ * @return Accordance соотв-ие, являющееся инверсией соответствия X
+ */
+Accordance inverse(const Accordance &x) {
+	OperationTimer timer("inverse(Accordance)", x.getGraph().size());
+	InvertedAccordance view(x);
+	Accordance result(
+			Accordance::Sorted(),
+			IntVector(x.arrivalArea, currentMemoryResource),
+			IntVector(x.departureArea, currentMemoryResource),
+			view.toGraph()
+	);
+	
+	// Перестановка инверсии по второму элементу обратна перестановке оригинала,
+	// поэтому повторная инверсия тоже обойдётся без сортировки
+	const std::vector<size_t> &order = view.getOrder();
+	std::shared_ptr< std::vector<size_t> > reverse = std::make_shared< std::vector<size_t> >(order.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		(*reverse)[order[i]] = i;
+	}
+	result.inversionOrder = std::move(reverse);
+	
+	return result;
+}
+
+/**
+ * @brief Инвертированный вид соответствия X без копирования графика
+ *
+ * @param x соответствие X
+ * @return InvertedAccordance вид инверсии соответствия X
+ */
+InvertedAccordance inverted(const Accordance &x) {
+	return InvertedAccordance(x);
+}
+
+/**
+ * @brief Инверсия инвертированного вида - исходное соответствие
+ *
+ * @param x вид инверсии
+ * @return const Accordance& исходное соответствие
+ */
+const Accordance &inverse(const InvertedAccordance &x) {
+	return x.getBase();
+}
+
+/**
+ * @brief Композиция двух соответствий
+ *
+ * @param x первое соответствие
+ * @param y второе соответствие
+ * @return Accordance соотв-ие, являющееся композицией соответствий X и Y
+ */
+Accordance composition(const Accordance &x, const Accordance &y) {
+	OperationTimer timer("composition(Accordance)", x.getGraph().size() + y.getGraph().size());
+	return Accordance(
+			IntVector(x.departureArea, currentMemoryResource),
+			IntVector(y.arrivalArea, currentMemoryResource),
+			composition(x.graph, y.graph)
+	);
+}
+
+/**
+ * @brief Композиция соответствия и инверсии другого соответствия (X o Y^-1)
+ *        без построения инверсии: продолжения ищутся в инвертированном виде
+ *
+ * @param x первое соответствие
+ * @param y вид инверсии второго соответствия
+ * @return Accordance соотв-ие, являющееся композицией соответствий X и Y^-1
+ */
+Accordance composition(const Accordance &x, const InvertedAccordance &y) {
+	OperationTimer timer("composition(Accordance, Inverted)", x.getGraph().size() + y.size());
+	return Accordance(
+			Accordance::Sorted(),
+			IntVector(x.getDepartureArea(), currentMemoryResource),
+			IntVector(y.getArrivalArea(), currentMemoryResource),
+			composeSortedGraphs(x.getGraph(), y)
+	);
+}
+
+/**
+ * @brief Композиция инверсии соответствия и другого соответствия (X^-1 o Y)
+ *        без построения инверсии
+ *
+ * @param x вид инверсии первого соответствия
+ * @param y второе соответствие
+ * @return Accordance соотв-ие, являющееся композицией соответствий X^-1 и Y
+ */
+Accordance composition(const InvertedAccordance &x, const Accordance &y) {
+	OperationTimer timer("composition(Inverted, Accordance)", x.size() + y.getGraph().size());
+	return Accordance(
+			Accordance::Sorted(),
+			IntVector(x.getDepartureArea(), currentMemoryResource),
+			IntVector(y.getArrivalArea(), currentMemoryResource),
+			composeSortedGraphs(x, y.getGraph())
+	);
+}
+
+/**
+ * @brief Наибольшее взаимно однозначное подсоответствие (наибольшее
+ *        паросочетание в двудольном графе соответствия) алгоритмом
+ *        Хопкрофта-Карпа за O(E√V). Элементы области значений сжимаются в
+ *        номера, смежность хранится построчно сжатой (CSR): график уже
+ *        отсортирован по первому элементу. Каждая фаза строит слои обходом в
+ *        ширину от свободных элементов слева и находит набор кратчайших
+ *        непересекающихся увеличивающих путей обходом в глубину (с явным
+ *        стеком, чтобы длинные пути не переполняли стек вызовов)
+ *
+ * @param x соответствие X
+ * @return Accordance соответствие с теми же областями и графиком из пар
+ *         наибольшего паросочетания
+ */
+Accordance maximumMatching(const Accordance &x) {
+	const PairVector &g = x.getGraph();
+	OperationTimer timer("maximumMatching", g.size());
+	
+	// Левая доля - различные первые элементы, правая - различные вторые
+	IntVector left(currentMemoryResource);
+	std::vector<size_t> offsets, targets(g.size());
+	IntVector right = projection(g, &std::pair<int, int>::second);
+	for (size_t e = 0; e < g.size(); e++) {
+		if (left.empty() || left.back() != g[e].first) {
+			left.push_back(g[e].first);
+			offsets.push_back(e);
+		}
+		targets[e] = branchlessLowerBound(right.data(), right.size(), g[e].second);
+	}
+	offsets.push_back(g.size());
+	
+	const size_t n = left.size(), free = right.size(); // free - нет пары
+	const size_t infinity = SIZE_MAX;
+	std::vector<size_t> matchLeft(n, free), matchRight(right.size(), n), distance(n), next(n), queue, stack;
+	queue.reserve(n);
+	
+	// Жадное начальное паросочетание сокращает число фаз
+	for (size_t u = 0; u < n; u++) {
+		for (size_t e = offsets[u]; e < offsets[u + 1]; e++) {
+			if (matchRight[targets[e]] == n) {
+				matchLeft[u] = targets[e];
+				matchRight[targets[e]] = u;
+				break;
+			}
+		}
+	}
+	
+	while (true) {
+		// Слои: расстояние от свободных элементов слева по чередующимся путям
+		queue.clear();
+		for (size_t u = 0; u < n; u++) {
+			distance[u] = (matchLeft[u] == free) ? 0 : infinity;
+			if (distance[u] == 0) {
+				queue.push_back(u);
+			}
+		}
+		size_t shortest = infinity; // длина кратчайшего увеличивающего пути
+		for (size_t k = 0; k < queue.size(); k++) {
+			size_t u = queue[k];
+			if (distance[u] >= shortest) {
+				continue;
+			}
+			for (size_t e = offsets[u]; e < offsets[u + 1]; e++) {
+				size_t w = matchRight[targets[e]];
+				if (w == n) {
+					shortest = std::min(shortest, distance[u] + 1);
+				} else if (distance[w] == infinity) {
+					distance[w] = distance[u] + 1;
+					queue.push_back(w);
 				}
-				if (!found(this->graph, {1 + i, graph[i][j]})) {
-					this->graph.emplace_back(1 + i, graph[i][j]);
+			}
+		}
+		if (shortest == infinity) {
+			break;
+		}
+		
+		// Увеличивающие пути по слоям; тупиковые элементы исключаются до конца фазы
+		std::copy(offsets.begin(), offsets.end() - 1, next.begin());
+		for (size_t root = 0; root < n; root++) {
+			if (matchLeft[root] != free) {
+				continue;
+			}
+			stack.assign(1, root);
+			while (!stack.empty()) {
+				size_t u = stack.back();
+				if (next[u] == offsets[u + 1]) {
+					distance[u] = infinity;
+					stack.pop_back();
+					if (!stack.empty()) {
+						next[stack.back()]++;
+					}
+					continue;
+				}
+				size_t w = matchRight[targets[next[u]]];
+				if (w == n) {
+					// Путь найден: пары вдоль стека переключаются на рёбра next
+					for (size_t v : stack) {
+						matchLeft[v] = targets[next[v]];
+						matchRight[targets[next[v]]] = v;
+					}
+					stack.clear();
+				} else if (distance[w] == distance[u] + 1) {
+					stack.push_back(w);
+				} else {
+					next[u]++;
 				}
 			}
 		}
+	}
+	
+	PairVector matching(currentMemoryResource);
+	for (size_t u = 0; u < n; u++) {
+		if (matchLeft[u] != free) {
+			matching.emplace_back(left[u], right[matchLeft[u]]);
+		}
+	}
+	return Accordance(
+			Accordance::Sorted(),
+			IntVector(x.getDepartureArea(), currentMemoryResource),
+			IntVector(x.getArrivalArea(), currentMemoryResource),
+			std::move(matching)
+	);
+}
+
+/**
+ * @brief Проверка, содержит ли соответствие биекцию своей области
+ *        отправления на область прибытия: наибольшее паросочетание должно
+ *        покрывать обе области
+ *
+ * @param x соответствие X
+ * @return true если в графике X есть биекция X на Y
+ * @return false если нет
+ */
+bool containsBijection(const Accordance &x) {
+	OperationTimer timer("containsBijection", x.getGraph().size());
+	if (x.getDepartureArea().size() != x.getArrivalArea().size() ||
+	    x.getGraph().size() < x.getDepartureArea().size()) {
+		return false;
+	}
+	return maximumMatching(x).isBijection();
+}
+
+// Наибольший размер части при разбиении отсортированного массива на части
+const size_t PERSISTENT_CHUNK_SIZE = 512;
+
+/**
+ * @brief Отсортированный массив, разбитый на части со счётчиками ссылок.
+ *        Копия (снимок) разделяет все части с оригиналом; при изменении
+ *        копируется только затронутая часть, если она кому-то ещё нужна
+ *        (копирование при записи). Поэтому память на ряд версий растёт с
+ *        числом правок, а не с числом версий, умноженным на размер.
+ *        Снимки можно читать из разных потоков, сам объект изменяется из одного
+ *
+ * @tparam T тип элементов
+ */
+template<typename T>
+class PersistentSortedVector {
+private:
+	std::vector< std::shared_ptr< std::vector<T> > > chunks; // части непусты
+	size_t total = 0;
+	
+	/**
+	 * @brief Номер первой части, последний элемент которой не меньше
+	 *        заданного, или число частей, если такой нет
+	 */
+	[[nodiscard]] size_t findChunk(const T &element) const {
+		return (size_t)(std::partition_point(this->chunks.begin(), this->chunks.end(),
+		                                     [&element](const std::shared_ptr< std::vector<T> > &chunk) {
+			return chunk->back() < element;
+		}) - this->chunks.begin());
+	}
+	
+	/**
+	 * @brief Часть для изменения: разделяемая с другими снимками сначала копируется
+	 */
+	std::vector<T> &writableChunk(size_t c) {
+		if (this->chunks[c].use_count() > 1) {
+			this->chunks[c] = std::make_shared< std::vector<T> >(*this->chunks[c]);
+		}
+		return *this->chunks[c];
+	}
+public:
+	PersistentSortedVector() = default;
+	
+	/**
+	 * @brief Разбиение отсортированного массива на части; повторы
+	 *        пропускаются, как при поэлементной вставке
+	 */
+	template<typename Vector>
+	explicit PersistentSortedVector(const Vector &sorted) {
+		for (const T &element : sorted) {
+			if (!this->chunks.empty() && this->chunks.back()->back() == element) {
+				continue;
+			}
+			if (this->chunks.empty() || this->chunks.back()->size() == PERSISTENT_CHUNK_SIZE) {
+				this->chunks.push_back(std::make_shared< std::vector<T> >());
+				this->chunks.back()->reserve(PERSISTENT_CHUNK_SIZE);
+			}
+			this->chunks.back()->push_back(element);
+			this->total++;
+		}
+	}
+	
+	[[nodiscard]] size_t size() const {
+		return this->total;
+	}
+	
+	[[nodiscard]] size_t chunkCount() const {
+		return this->chunks.size();
+	}
+	
+	[[nodiscard]] bool contains(const T &element) const {
+		size_t c = this->findChunk(element);
+		return c < this->chunks.size() && sortedContains(this->chunks[c]->data(), this->chunks[c]->size(), element);
+	}
+	
+	/**
+	 * @brief Добавление элемента, если его ещё нет. Переполненная часть
+	 *        делится пополам
+	 *
+	 * @return true если элемент добавлен
+	 */
+	bool insert(const T &element) {
+		if (this->chunks.empty()) {
+			this->chunks.push_back(std::make_shared< std::vector<T> >(1, element));
+			this->total++;
+			return true;
+		}
 		
-		std::sort(this->departureArea.begin(), this->departureArea.end());
-		std::sort(this->arrivalArea.begin(), this->arrivalArea.end());
-		std::sort(this->graph.begin(), this->graph.end());
+		size_t c = std::min(this->findChunk(element), this->chunks.size() - 1);
+		const std::vector<T> &current = *this->chunks[c];
+		size_t position = branchlessLowerBound(current.data(), current.size(), element);
+		if (position < current.size() && current[position] == element) {
+			return false;
+		}
+		
+		std::vector<T> &chunk = this->writableChunk(c);
+		chunk.insert(chunk.begin() + (ptrdiff_t)position, element);
+		this->total++;
+		if (chunk.size() > 2 * PERSISTENT_CHUNK_SIZE) {
+			std::shared_ptr< std::vector<T> > upper = std::make_shared< std::vector<T> >(
+					chunk.begin() + (ptrdiff_t)PERSISTENT_CHUNK_SIZE, chunk.end());
+			chunk.resize(PERSISTENT_CHUNK_SIZE);
+			this->chunks.insert(this->chunks.begin() + (ptrdiff_t)c + 1, std::move(upper));
+		}
+		return true;
+	}
+	
+	/**
+	 * @brief Удаление элемента; опустевшая часть удаляется
+	 *
+	 * @return true если элемент был
+	 */
+	bool erase(const T &element) {
+		size_t c = this->findChunk(element);
+		if (c == this->chunks.size()) {
+			return false;
+		}
+		const std::vector<T> &current = *this->chunks[c];
+		size_t position = branchlessLowerBound(current.data(), current.size(), element);
+		if (position == current.size() || !(current[position] == element)) {
+			return false;
+		}
+		
+		std::vector<T> &chunk = this->writableChunk(c);
+		chunk.erase(chunk.begin() + (ptrdiff_t)position);
+		this->total--;
+		if (chunk.empty()) {
+			this->chunks.erase(this->chunks.begin() + (ptrdiff_t)c);
+		}
+		return true;
+	}
+	
+	/**
+	 * @brief Число частей, общих с другим снимком
+	 */
+	[[nodiscard]] size_t sharedChunks(const PersistentSortedVector &other) const {
+		std::unordered_set<const std::vector<T> *> own;
+		for (const std::shared_ptr< std::vector<T> > &chunk : this->chunks) {
+			own.insert(chunk.get());
+		}
+		return (size_t)std::count_if(other.chunks.begin(), other.chunks.end(),
+		                             [&own](const std::shared_ptr< std::vector<T> > &chunk) {
+			return own.count(chunk.get()) > 0;
+		});
+	}
+	
+	/**
+	 * @brief Сборка элементов в один отсортированный массив
+	 */
+	[[nodiscard]] std::pmr::vector<T> toVector() const {
+		std::pmr::vector<T> result(currentMemoryResource);
+		result.reserve(this->total);
+		for (const std::shared_ptr< std::vector<T> > &chunk : this->chunks) {
+			result.insert(result.end(), chunk->begin(), chunk->end());
+		}
+		return result;
+	}
+};
+
+/**
+ * @brief Версия соответствия со структурным разделением: области и график
+ *        хранятся частями с копированием при записи. snapshot() стоит
+ *        O(|X| + |Y| + |G|) / PERSISTENT_CHUNK_SIZE копий указателей, каждая
+ *        правка копирует не больше одной части
+ */
+class PersistentAccordance {
+private:
+	PersistentSortedVector<int> departureArea;
+	PersistentSortedVector<int> arrivalArea;
+	PersistentSortedVector< std::pair<int, int> > graph;
+public:
+	PersistentAccordance() = default;
+	
+	explicit PersistentAccordance(const Accordance &a)
+			: departureArea(a.getDepartureArea()),
+			  arrivalArea(a.getArrivalArea()),
+			  graph(a.getGraph()) {}
+	
+	/**
+	 * @brief Снимок текущей версии: разделяет с ней все части
+	 *
+	 * @return PersistentAccordance независимо изменяемая версия
+	 */
+	[[nodiscard]] PersistentAccordance snapshot() const {
+		return *this;
+	}
+	
+	[[nodiscard]] const PersistentSortedVector<int> &getDepartureArea() const {
+		return this->departureArea;
+	}
+	
+	[[nodiscard]] const PersistentSortedVector<int> &getArrivalArea() const {
+		return this->arrivalArea;
+	}
+	
+	[[nodiscard]] const PersistentSortedVector< std::pair<int, int> > &getGraph() const {
+		return this->graph;
+	}
+	
+	bool addDepartureElement(int x) {
+		return this->departureArea.insert(x);
+	}
+	
+	bool removeDepartureElement(int x) {
+		return this->departureArea.erase(x);
+	}
+	
+	bool addArrivalElement(int y) {
+		return this->arrivalArea.insert(y);
+	}
+	
+	bool removeArrivalElement(int y) {
+		return this->arrivalArea.erase(y);
+	}
+	
+	bool addPair(int x, int y) {
+		return this->graph.insert({x, y});
+	}
+	
+	bool removePair(int x, int y) {
+		return this->graph.erase({x, y});
+	}
+	
+	[[nodiscard]] bool containsPair(int x, int y) const {
+		return this->graph.contains({x, y});
+	}
+	
+	/**
+	 * @brief Обычное соответствие с содержимым версии (части уже отсортированы)
+	 *
+	 * @return Accordance соответствие
+	 */
+	[[nodiscard]] Accordance toAccordance() const {
+		OperationTimer timer("PersistentAccordance::toAccordance", this->graph.size());
+		return Accordance(
+				Accordance::Sorted(),
+				this->departureArea.toVector(),
+				this->arrivalArea.toVector(),
+				this->graph.toVector()
+		);
+	}
+};
+
+/**
+ * @brief Ограниченный кэш результатов с вытеснением давно не использованных
+ *        записей. Ключ - операция и отпечатки операндов
+ *
+ * @tparam Value тип результата
+ */
+template<typename Value>
+class LruCache {
+public:
+	struct Key {
+		int operation;
+		Fingerprint x;
+		Fingerprint y;
+		
+		bool operator==(const Key &other) const {
+			return this->operation == other.operation && this->x == other.x && this->y == other.y;
+		}
+	};
+	
+	explicit LruCache(size_t capacity = 64)
+			: capacity(capacity) {}
+	
+	/**
+	 * @brief Результат по ключу: из кэша, если он там есть, иначе вычисляется
+	 *        функцией compute и запоминается. Ссылка действительна до
+	 *        следующего обращения к кэшу
+	 */
+	template<typename Compute>
+	const Value &get(const Key &key, Compute compute) {
+		auto it = this->index.find(key);
+		if (it != this->index.end()) {
+			++this->hits;
+			this->entries.splice(this->entries.begin(), this->entries, it->second);
+			return it->second->second;
+		}
+		
+		++this->misses;
+		this->entries.emplace_front(key, compute());
+		this->index[key] = this->entries.begin();
+		if (this->entries.size() > this->capacity) {
+			this->index.erase(this->entries.back().first);
+			this->entries.pop_back();
+		}
+		return this->entries.front().second;
+	}
+	
+	[[nodiscard]] size_t getHits() const {
+		return this->hits;
+	}
+	
+	[[nodiscard]] size_t getMisses() const {
+		return this->misses;
+	}
+
+private:
+	struct KeyHash {
+		size_t operator()(const Key &key) const {
+			return (size_t)(key.x.low * 31 + key.y.high * 17 + (uint64_t)key.operation);
+		}
+	};
+	
+	size_t capacity;
+	size_t hits = 0;
+	size_t misses = 0;
+	std::list< std::pair<Key, Value> > entries; // в начале - недавно использованные
+	std::unordered_map<Key, typename std::list< std::pair<Key, Value> >::iterator, KeyHash> index;
+};
+
+/**
+ * @brief Операции над соответствиями с кэшированием результатов по
+ *        отпечаткам операндов. Результаты хранятся в куче, а не в арене
+ *        запроса, поэтому переживают запрос, в котором были вычислены
+ */
+class AccordanceCache {
+public:
+	enum Operation {
+		UNITE,
+		INTERSECT,
+		DIFFERENCE,
+		INVERSE,
+		COMPOSITION
+	};
+	
+	explicit AccordanceCache(size_t capacity = 64)
+			: cache(capacity) {}
+	
+	/**
+	 * @brief Результат операции над соответствиями x и y (для инверсии y не
+	 *        используется). Ссылка действительна до следующего обращения к кэшу
+	 */
+	const Accordance &compute(Operation operation, const Accordance &x, const Accordance &y) {
+		Fingerprint fy = (operation == INVERSE) ? Fingerprint() : y.getFingerprint();
+		return this->cache.get({operation, x.getFingerprint(), fy}, [&]() {
+			MemoryResourceScope heap(std::pmr::new_delete_resource());
+			switch (operation) {
+				case UNITE:
+					return unite(x, y);
+				case INTERSECT:
+					return intersect(x, y);
+				case DIFFERENCE:
+					return difference(x, y);
+				case INVERSE:
+					return inverse(x);
+				default:
+					return composition(x, y);
+			}
+		});
+	}
+	
+	[[nodiscard]] size_t getHits() const {
+		return this->cache.getHits();
+	}
+	
+	[[nodiscard]] size_t getMisses() const {
+		return this->cache.getMisses();
+	}
+
+private:
+	LruCache<Accordance> cache;
+};
+
+/**
+ * @brief Операция узла плана запроса над соответствиями
+ */
+enum class QueryOperation {
+	Source,
+	Unite,
+	Intersect,
+	Difference,
+	Inverse,
+	Composition,
+	RestrictDefinition, // пары, первый элемент которых лежит в области определения фильтра
+	RestrictValue       // пары, второй элемент которых лежит в области значений фильтра
+};
+
+/**
+ * @brief Узел плана запроса. Для Source хранится исходное соответствие, для
+ *        Restrict* в right лежит план фильтра
+ */
+struct QueryNode {
+	QueryOperation operation;
+	const Accordance *source;
+	std::shared_ptr<const QueryNode> left;
+	std::shared_ptr<const QueryNode> right;
+};
+
+using QueryPlan = std::shared_ptr<const QueryNode>;
+
+/**
+ * @brief Создание узла плана
+ */
+QueryPlan makeQueryNode(QueryOperation operation, QueryPlan left, QueryPlan right = nullptr) {
+	return std::make_shared<const QueryNode>(QueryNode{operation, nullptr, std::move(left), std::move(right)});
+}
+
+/**
+ * @brief Оценка мощности промежуточного результата
+ */
+struct CardinalityEstimate {
+	double pairs;      // мощность графика
+	double definition; // мощность области определения
+	double value;      // мощность области значений
+};
+
+/**
+ * @brief Точная статистика графика: число пар, различных первых и различных
+ *        вторых элементов (средние степени - их отношения)
+ *
+ * @param g отсортированный график
+ * @return CardinalityEstimate статистика
+ */
+template<typename Allocator>
+CardinalityEstimate graphStatistics(const std::vector< std::pair<int, int>, Allocator > &g) {
+	std::vector<int> seconds;
+	seconds.reserve(g.size());
+	double definition = 0;
+	for (size_t i = 0; i < g.size(); i++) {
+		if (i == 0 || g[i].first != g[i - 1].first) {
+			++definition;
+		}
+		seconds.push_back(g[i].second);
+	}
+	std::sort(seconds.begin(), seconds.end());
+	double value = (double)(std::unique(seconds.begin(), seconds.end()) - seconds.begin());
+	return {(double)g.size(), definition, value};
+}
+
+/**
+ * @brief Оценка мощности композиции по статистикам сомножителей. Классическая
+ *        оценка соединения: |X∘Y| ≈ |X|·|Y| / max(V(X.2), V(Y.1)), но не больше
+ *        произведения областей определения и значений
+ */
+CardinalityEstimate composeEstimates(const CardinalityEstimate &l, const CardinalityEstimate &r) {
+	double pairs = l.pairs * r.pairs / std::max(1.0, std::max(l.value, r.definition));
+	pairs = std::min(pairs, l.definition * r.value);
+	return {pairs, std::min(l.definition, pairs), std::min(r.value, pairs)};
+}
+
+/**
+ * @brief Оценка мощности результата узла плана по размерам исходных соответствий
+ *
+ * @param plan план
+ * @return CardinalityEstimate оценка
+ */
+CardinalityEstimate estimateCardinality(const QueryPlan &plan) {
+	switch (plan->operation) {
+		case QueryOperation::Source:
+			return graphStatistics(plan->source->getGraph());
+		case QueryOperation::Unite: {
+			CardinalityEstimate l = estimateCardinality(plan->left);
+			CardinalityEstimate r = estimateCardinality(plan->right);
+			return {l.pairs + r.pairs, l.definition + r.definition, l.value + r.value};
+		}
+		case QueryOperation::Intersect: {
+			CardinalityEstimate l = estimateCardinality(plan->left);
+			CardinalityEstimate r = estimateCardinality(plan->right);
+			return {std::min(l.pairs, r.pairs), std::min(l.definition, r.definition),
+			        std::min(l.value, r.value)};
+		}
+		case QueryOperation::Difference:
+			return estimateCardinality(plan->left);
+		case QueryOperation::Inverse: {
+			CardinalityEstimate c = estimateCardinality(plan->left);
+			return {c.pairs, c.value, c.definition};
+		}
+		case QueryOperation::Composition:
+			return composeEstimates(estimateCardinality(plan->left), estimateCardinality(plan->right));
+		case QueryOperation::RestrictDefinition:
+		case QueryOperation::RestrictValue: {
+			CardinalityEstimate c = estimateCardinality(plan->left);
+			CardinalityEstimate f = estimateCardinality(plan->right);
+			double selectivity = plan->operation == QueryOperation::RestrictDefinition
+			                     ? std::min(1.0, f.definition / std::max(1.0, c.definition))
+			                     : std::min(1.0, f.value / std::max(1.0, c.value));
+			return {c.pairs * selectivity, c.definition, c.value};
+		}
+	}
+	return {0, 0, 0};
+}
+
+/**
+ * @brief Разворачивает дерево композиций в цепочку сомножителей
+ */
+void collectCompositionChain(const QueryPlan &plan, std::vector<QueryPlan> &factors) {
+	if (plan->operation == QueryOperation::Composition) {
+		collectCompositionChain(plan->left, factors);
+		collectCompositionChain(plan->right, factors);
+	} else {
+		factors.push_back(plan);
+	}
+}
+
+/**
+ * @brief Расстановка скобок в цепочке композиций динамическим
+ *        программированием, как в задаче о перемножении цепочки матриц:
+ *        композиция ассоциативна, и для каждого отрезка цепочки выбирается
+ *        точка разбиения с наименьшей суммарной стоимостью. Стоимость одной
+ *        композиции - мощности обоих операндов и оценка мощности результата,
+ *        поэтому порядок с огромным промежуточным результатом не выбирается
+ *
+ * @param factors статистики сомножителей
+ * @return std::vector< std::vector<size_t> > split[i][j] - последний
+ *         сомножитель левой части для отрезка [i; j]
+ */
+std::vector< std::vector<size_t> > compositionChainSplits(const std::vector<CardinalityEstimate> &factors) {
+	size_t n = factors.size();
+	std::vector< std::vector<double> > cost(n, std::vector<double>(n, 0));
+	std::vector< std::vector<CardinalityEstimate> > estimate(n, std::vector<CardinalityEstimate>(n));
+	std::vector< std::vector<size_t> > split(n, std::vector<size_t>(n, 0));
+	for (size_t i = 0; i < n; i++) {
+		estimate[i][i] = factors[i];
+	}
+	
+	for (size_t length = 2; length <= n; length++) {
+		for (size_t i = 0; i + length <= n; i++) {
+			size_t j = i + length - 1;
+			cost[i][j] = HUGE_VAL;
+			for (size_t k = i; k < j; k++) {
+				CardinalityEstimate result = composeEstimates(estimate[i][k], estimate[k + 1][j]);
+				double total = cost[i][k] + cost[k + 1][j] +
+				               estimate[i][k].pairs + estimate[k + 1][j].pairs + result.pairs;
+				if (total < cost[i][j]) {
+					cost[i][j] = total;
+					estimate[i][j] = result;
+					split[i][j] = k;
+				}
+			}
+		}
+	}
+	
+	return split;
+}
+
+/**
+ * @brief Сборка плана цепочки композиций factors[i..j] по таблице разбиений
+ */
+QueryPlan buildCompositionChain(const std::vector<QueryPlan> &factors,
+                                const std::vector< std::vector<size_t> > &split, size_t i, size_t j) {
+	if (i == j) {
+		return factors[i];
+	}
+	return makeQueryNode(QueryOperation::Composition, buildCompositionChain(factors, split, i, split[i][j]),
+	                     buildCompositionChain(factors, split, split[i][j] + 1, j));
+}
+
+/**
+ * @brief Расстановка скобок в цепочке композиций плана по оценкам мощности
+ */
+QueryPlan orderCompositionChain(std::vector<QueryPlan> factors) {
+	std::vector<CardinalityEstimate> estimates;
+	for (const QueryPlan &factor : factors) {
+		estimates.push_back(estimateCardinality(factor));
 	}
-	
-	/**
-	 * @brief Область отправления соответствия
-	 *
-	 * @return std::vector<int> область отправления соответствия
-	 */
-	[[nodiscard]] std::vector<int> getDepartureArea() const {
-		return this->departureArea;
+	return buildCompositionChain(factors, compositionChainSplits(estimates), 0, factors.size() - 1);
+}
+
+/**
+ * @brief Вычисление цепочки композиций chain[i..j] по таблице разбиений
+ */
+Accordance evaluateCompositionChain(const std::vector<Accordance> &chain,
+                                    const std::vector< std::vector<size_t> > &split, size_t i, size_t j) {
+	if (i == j) {
+		return chain[i];
 	}
-	
-	/**
-	 * @brief Область прибытия соответствия
-	 *
-	 * @return std::vector<int> область прибытия соответствия
-	 */
-	[[nodiscard]] std::vector<int> getArrivalArea() const {
-		return this->arrivalArea;
+	return composition(evaluateCompositionChain(chain, split, i, split[i][j]),
+	                   evaluateCompositionChain(chain, split, split[i][j] + 1, j));
+}
+
+/**
+ * @brief Композиция цепочки соответствий chain[0]∘chain[1]∘...∘chain[k - 1].
+ *        Порядок вычисления выбирается заранее по статистикам степеней
+ *        сомножителей (см. compositionChainSplits), результат от него не зависит
+ *
+ * @param chain сомножители
+ * @return Accordance композиция всех сомножителей
+ */
+Accordance compositionChain(const std::vector<Accordance> &chain) {
+	if (chain.empty()) {
+		return Accordance();
 	}
+	OperationTimer timer("compositionChain", chain.size());
 	
-	/**
-	 * @brief График соответствия
-	 *
-	 * @return std::vector< std::pair<int, int> > соответствия
-	 */
-	[[nodiscard]] std::vector< std::pair<int, int> > getGraph() const {
-		return this->graph;
+	std::vector<CardinalityEstimate> statistics;
+	for (const Accordance &factor : chain) {
+		statistics.push_back(graphStatistics(factor.getGraph()));
 	}
-	
-	/**
-	 * @brief Область определения соответствия
-	 *
-	 * @return std::vector<int> область определения соответствия
-	 */
-	[[nodiscard]] std::vector<int> definitionArea() const {
-		std::vector<int> result;
-		
-		for (const std::pair<int, int> &current : this->graph) {
-			if (!found(result, current.first)) {
-				result.push_back(current.first);
+	return evaluateCompositionChain(chain, compositionChainSplits(statistics), 0, chain.size() - 1);
+}
+
+/**
+ * @brief Оптимизация плана:
+ *        - двойная инверсия сокращается, инверсия композиции опускается к
+ *          сомножителям (Inv(X∘Y) = Inv(Y)∘Inv(X));
+ *        - цепочки композиций переупорядочиваются по оценке мощности;
+ *        - пересечение с композицией опускает фильтры под композицию:
+ *          (X∘Y) ∩ Z = (X|dom Z ∘ Y|ran Z) ∩ Z
+ *
+ * @param plan исходный план
+ * @return QueryPlan оптимизированный план
+ */
+QueryPlan optimizeQuery(const QueryPlan &plan) {
+	switch (plan->operation) {
+		case QueryOperation::Source:
+			return plan;
+		case QueryOperation::Inverse: {
+			QueryPlan child = optimizeQuery(plan->left);
+			if (child->operation == QueryOperation::Inverse) {
+				return child->left;
 			}
+			if (child->operation == QueryOperation::Composition) {
+				return optimizeQuery(makeQueryNode(
+						QueryOperation::Composition,
+						makeQueryNode(QueryOperation::Inverse, child->right),
+						makeQueryNode(QueryOperation::Inverse, child->left)
+				));
+			}
+			return makeQueryNode(QueryOperation::Inverse, child);
 		}
-		std::sort(result.begin(), result.end());
-		
-		return result;
-	}
-	
-	/**
-	 * @brief Область значений соответствия
-	 *
-	 * @return std::vector<int> область значений соответствия
-	 */
-	[[nodiscard]] std::vector<int> valueArea() const {
-		std::vector<int> result;
-		
-		for (const std::pair<int, int> &current : this->graph) {
-			if (!found(result, current.second)) {
-				result.push_back(current.second);
+		case QueryOperation::Composition: {
+			std::vector<QueryPlan> factors;
+			collectCompositionChain(optimizeQuery(plan->left), factors);
+			collectCompositionChain(optimizeQuery(plan->right), factors);
+			return orderCompositionChain(factors);
+		}
+		case QueryOperation::Intersect: {
+			QueryPlan l = optimizeQuery(plan->left);
+			QueryPlan r = optimizeQuery(plan->right);
+			auto pushDown = [](const QueryPlan &composition, const QueryPlan &filter) {
+				return makeQueryNode(
+						QueryOperation::Composition,
+						makeQueryNode(QueryOperation::RestrictDefinition, composition->left, filter),
+						makeQueryNode(QueryOperation::RestrictValue, composition->right, filter)
+				);
+			};
+			if (l->operation == QueryOperation::Composition) {
+				l = pushDown(l, r);
+			} else if (r->operation == QueryOperation::Composition) {
+				r = pushDown(r, l);
 			}
+			return makeQueryNode(QueryOperation::Intersect, l, r);
 		}
-		std::sort(result.begin(), result.end());
-		
-		return result;
-	}
-	
-	/**
-	 * @brief Проверка, является ли соответствие всюду определённым
-	 *
-	 * @return true если соответствие является всюду определённым
-	 * @return false если нет
-	 */
-	[[nodiscard]] bool isEverywhereDefined() const {
-		return this->definitionArea() == this->departureArea;
+		default:
+			return makeQueryNode(plan->operation, optimizeQuery(plan->left),
+			                     plan->right ? optimizeQuery(plan->right) : nullptr);
 	}
+}
+
+/**
+ * @brief Исполнитель плана. Инверсия, фильтры и левый операнд композиции
+ *        работают конвейерно, передавая пары друг другу без промежуточных
+ *        графиков; материализуются только правые операнды композиций
+ *        (как индекс), операнды слияний (объединение, пересечение, разность)
+ *        и итоговый результат. Общие подпланы вычисляются один раз
+ */
+class QueryExecutor {
+public:
+	using PairSink = std::function<void(const std::pair<int, int> &)>;
 	
 	/**
-	 * @brief Проверка, является ли соответствие сюръективным
-	 *
-	 * @return true если соответствие является сюръективным
-	 * @return false если нет
+	 * @brief Вычисленный узел плана
 	 */
-	[[nodiscard]] bool isSurjective() const {
-		return this->valueArea() == this->arrivalArea;
-	}
+	struct Result {
+		IntVector departureArea;
+		IntVector arrivalArea;
+		PairVector ownGraph;
+		const PairVector *graph = nullptr; // либо график источника, либо ownGraph
+	};
 	
 	/**
-	 * @brief Проверка, является ли соответствие функциональным
-	 *
-	 * @return true если соответствие является функциональным
-	 * @return false если нет
+	 * @brief Области отправления и прибытия узла (без вычисления графика)
 	 */
-	[[nodiscard]] bool isFunctional() const {
-		std::map<int, int> firstCount;
+	const std::pair<IntVector, IntVector> &areas(const QueryNode &node) {
+		auto it = this->areaCache.find(&node);
+		if (it != this->areaCache.end()) {
+			return it->second;
+		}
 		
-		for (const std::pair<int, int> &current : this->graph) {
-			++firstCount[current.first];
+		std::pair<IntVector, IntVector> result;
+		switch (node.operation) {
+			case QueryOperation::Source:
+				result = {IntVector(node.source->getDepartureArea(), currentMemoryResource),
+				          IntVector(node.source->getArrivalArea(), currentMemoryResource)};
+				break;
+			case QueryOperation::Unite:
+				result = {unite(this->areas(*node.left).first, this->areas(*node.right).first),
+				          unite(this->areas(*node.left).second, this->areas(*node.right).second)};
+				break;
+			case QueryOperation::Intersect:
+				result = {intersect(this->areas(*node.left).first, this->areas(*node.right).first),
+				          intersect(this->areas(*node.left).second, this->areas(*node.right).second)};
+				break;
+			case QueryOperation::Difference:
+				result = {difference(this->areas(*node.left).first, this->areas(*node.right).first),
+				          difference(this->areas(*node.left).second, this->areas(*node.right).second)};
+				break;
+			case QueryOperation::Inverse:
+				result = {this->areas(*node.left).second, this->areas(*node.left).first};
+				break;
+			case QueryOperation::Composition:
+				result = {this->areas(*node.left).first, this->areas(*node.right).second};
+				break;
+			case QueryOperation::RestrictDefinition:
+			case QueryOperation::RestrictValue:
+				result = this->areas(*node.left);
+				break;
 		}
+		std::sort(result.first.begin(), result.first.end());
+		std::sort(result.second.begin(), result.second.end());
 		
-		return std::all_of(firstCount.begin(), firstCount.end(),
-						   [](const std::pair<int, int> &element) {
-			return element.second <= 1;
-		});
+		return this->areaCache.emplace(&node, std::move(result)).first->second;
 	}
 	
 	/**
-	 * @brief Проверка, является ли соответствие инъективным
-	 *
-	 * @return true если соответствие является инъективным
-	 * @return false если нет
+	 * @brief Полное вычисление узла: области и отсортированный график без повторов
 	 */
-	[[nodiscard]] bool isInjective() const {
-		std::map<int, int> secondCount;
-		
-		for (const std::pair<int, int> &current : this->graph) {
-			++secondCount[current.second];
+	const Result &evaluate(const QueryNode &node) {
+		auto it = this->resultCache.find(&node);
+		if (it != this->resultCache.end()) {
+			return *it->second;
 		}
 		
-		return std::all_of(secondCount.begin(), secondCount.end(),
-					[](const std::pair<int, int> &element) {
-			return element.second <= 1;
-		});
-	}
-	
-	/**
-	 * @brief Проверка, является ли соответствие отображением X в Y
-	 *
-	 * @return true если соответствие является отображением X в Y
-	 * @return false если нет
-	 */
-	[[nodiscard]] bool isMappingIn() const {
-		return this->isEverywhereDefined() && this->isFunctional();
-	}
-	
-	/**
-	 * @brief Проверка, является ли соответствие отображением X на Y
-	 *
-	 * @return true если соответствие является отображением X на Y
-	 * @return false если нет
-	 */
-	[[nodiscard]] bool isMappingTo() const {
-		return this->isEverywhereDefined() && this->isFunctional() && this->isSurjective();
-	}
-	
-	/**
-	 * @brief Проверка, является ли соответствие взаимно однозначным
-	 *
-	 * @return true если соответствие является взаимно однозначным
-	 * @return false если нет
-	 */
-	[[nodiscard]] bool isOneToOne() const {
-		return this->isFunctional() && this->isInjective();
-	}
-	
-	/**
-	 * @brief Проверка, является ли соответствие биекцией
-	 *
-	 * @return true если соответствие является биекцией
-	 * @return false если нет
-	 */
-	[[nodiscard]] bool isBijection() const {
-		return (this->isEverywhereDefined() && this->isSurjective() &&
-		        this->isFunctional() && this->isInjective());
-	}
-	
-	/**
-	 * @brief Находит образ множества А
-	 *
-	 * @param a множество А
-	 * @return std::vector<int> образ множества А
-	 */
-	std::vector<int> findImage(const std::vector<int> &a) {
-		std::vector<int> gammaB;
+		std::unique_ptr<Result> result(new Result);
+		result->departureArea = this->areas(node).first;
+		result->arrivalArea = this->areas(node).second;
 		
-		for (const std::pair<int, int> &current : this->graph) {
-			if (found(a, current.first)) {
-				if (!found(gammaB, current.second)) {
-					gammaB.push_back(current.second);
-				}
+		if (node.operation == QueryOperation::Source) {
+			result->graph = &node.source->getGraph();
+		} else if (node.operation == QueryOperation::Unite ||
+		           node.operation == QueryOperation::Intersect ||
+		           node.operation == QueryOperation::Difference) {
+			const PairVector &x = *this->evaluate(*node.left).graph;
+			const PairVector &y = *this->evaluate(*node.right).graph;
+			PairVector &g = result->ownGraph;
+			if (node.operation == QueryOperation::Unite) {
+				std::set_union(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(g));
+			} else if (node.operation == QueryOperation::Intersect) {
+				std::set_intersection(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(g));
+			} else {
+				// Как и в difference(): пары должны лежать в разностях областей
+				std::set_difference(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(g));
+				const IntVector &d = result->departureArea;
+				const IntVector &a = result->arrivalArea;
+				g.erase(std::remove_if(g.begin(), g.end(), [&d, &a](const std::pair<int, int> &p) {
+					return !sortedContains(d.data(), d.size(), p.first) ||
+					       !sortedContains(a.data(), a.size(), p.second);
+				}), g.end());
 			}
+			result->graph = &result->ownGraph;
+		} else {
+			PairVector &g = result->ownGraph;
+			this->stream(node, [&g](const std::pair<int, int> &p) {
+				g.push_back(p);
+			});
+			std::sort(g.begin(), g.end());
+			g.erase(std::unique(g.begin(), g.end()), g.end());
+			result->graph = &result->ownGraph;
 		}
 		
-		return gammaB;
+		return *this->resultCache.emplace(&node, std::move(result)).first->second;
 	}
 	
 	/**
-	 * @brief Находит прообраз множества B
-	 *
-	 * @param b множество B
-	 * @return std::vector<int> прообраз множества B
+	 * @brief Конвейерная выдача пар графика узла (возможны повторы)
 	 */
-	std::vector<int> findPrototype(const std::vector<int> &b) {
-		std::vector<int> gammaMinus1B;
-		
-		for (const std::pair<int, int> &current : this->graph) {
-			if (found(b, current.second)) {
-				if (!found(gammaMinus1B, current.first)) {
-					gammaMinus1B.push_back(current.first);
+	void stream(const QueryNode &node, const PairSink &sink) {
+		switch (node.operation) {
+			case QueryOperation::Inverse:
+				this->stream(*node.left, [&sink](const std::pair<int, int> &p) {
+					sink(inversion(p));
+				});
+				break;
+			case QueryOperation::RestrictDefinition:
+			case QueryOperation::RestrictValue: {
+				bool byFirst = node.operation == QueryOperation::RestrictDefinition;
+				const PairVector &f = *this->evaluate(*node.right).graph;
+				IntVector keys(currentMemoryResource);
+				keys.reserve(f.size());
+				for (const std::pair<int, int> &p : f) {
+					keys.push_back(byFirst ? p.first : p.second);
+				}
+				std::sort(keys.begin(), keys.end());
+				keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+				
+				this->stream(*node.left, [&sink, &keys, byFirst](const std::pair<int, int> &p) {
+					if (sortedContains(keys.data(), keys.size(), byFirst ? p.first : p.second)) {
+						sink(p);
+					}
+				});
+			}
+				break;
+			case QueryOperation::Composition: {
+				if (node.right->operation == QueryOperation::Inverse &&
+				    node.right->left->operation == QueryOperation::Source) {
+					// Инверсия исходного соответствия уже отсортирована через его перестановку
+					InvertedAccordance index = inverted(*node.right->left->source);
+					this->stream(*node.left, [&sink, &index](const std::pair<int, int> &p) {
+						for (size_t i = index.lowerBound(p.second); i < index.size() && index[i].first == p.second; i++) {
+							sink({p.first, index[i].second});
+						}
+					});
+					break;
 				}
+				
+				// Индекс правого операнда: график, отсортированный по первому элементу
+				PairVector index(currentMemoryResource);
+				this->stream(*node.right, [&index](const std::pair<int, int> &p) {
+					index.push_back(p);
+				});
+				std::sort(index.begin(), index.end());
+				
+				this->stream(*node.left, [&sink, &index](const std::pair<int, int> &p) {
+					auto it = std::lower_bound(index.begin(), index.end(),
+					                           std::pair<int, int>(p.second, INT_MIN));
+					for (; it != index.end() && it->first == p.second; ++it) {
+						sink({p.first, it->second});
+					}
+				});
 			}
+				break;
+			default:
+				for (const std::pair<int, int> &p : *this->evaluate(node).graph) {
+					sink(p);
+				}
 		}
-		
-		return gammaMinus1B;
 	}
-	
-	friend Accordance unite(const Accordance &x, const Accordance &y);
-	friend Accordance intersect(const Accordance &x, const Accordance &y);
-	friend Accordance difference(const Accordance &x, const Accordance &y);
-	friend Accordance inverse(const Accordance &x);
-	friend Accordance composition(const Accordance &x, const Accordance &y);
-};
-
-/**
- * @brief Объединение двух соответствий
- *
- * @param x первое соответствие
- * @param y второе соответствие
- * @return Accordance соотв-ие, являющееся объединением соответствий X и Y
- */
-Accordance unite(const Accordance &x, const Accordance &y) {
-	return Accordance(
-			unite(x.getDepartureArea(), y.getDepartureArea()),
-			unite(x.getArrivalArea(), y.getArrivalArea()),
-			unite(x.getGraph(), y.getGraph())
-	);
-}
 
-/**
- * @brief Пересечение двух соответствий
- *
- * @param x первое соответствие
- * @param y второе соответствие
- * @return Accordance соотв-ие, являющееся пересечением соответствий X и Y
- */
-Accordance intersect(const Accordance &x, const Accordance &y) {
-	return Accordance(
-			intersect(x.getDepartureArea(), y.getDepartureArea()),
-			intersect(x.getArrivalArea(), y.getArrivalArea()),
-			intersect(x.getGraph(), y.getGraph())
-	);
-}
+private:
+	std::map<const QueryNode *, std::pair<IntVector, IntVector> > areaCache;
+	std::map<const QueryNode *, std::unique_ptr<Result> > resultCache;
+};
 
 /**
- * @brief Разность двух соответствий
- *
- * @param x первое соответствие
- * @param y второе соответствие
- * @return Accordance соотв-ие, являющееся разностью соответствий X и Y
+ * @brief Запрос над соответствиями. Операции над запросами только строят план;
+ *        evaluate() оптимизирует его и исполняет. Исходные соответствия должны
+ *        жить до вычисления запроса
  */
-Accordance difference(const Accordance &x, const Accordance &y) {
-	Accordance a = Accordance(
-			difference(x.getDepartureArea(), y.getDepartureArea()),
-			difference(x.getArrivalArea(), y.getArrivalArea()),
-			difference(x.getGraph(), y.getGraph())
-	);
+class AccordanceQuery {
+private:
+	QueryPlan plan;
+public:
+	explicit AccordanceQuery(const Accordance &source)
+			: plan(std::make_shared<const QueryNode>(QueryNode{QueryOperation::Source, &source, nullptr, nullptr})) {}
 	
-	for (size_t i = 0; i < a.graph.size(); i++) {
-		if (!found(a.departureArea, a.graph[i].first)) {
-			a.graph.erase(a.graph.begin() + (ptrdiff_t)i);
-			--i;
-		}
+	explicit AccordanceQuery(QueryPlan plan)
+			: plan(std::move(plan)) {}
+	
+	/**
+	 * @brief План запроса (без оптимизации)
+	 */
+	[[nodiscard]] const QueryPlan &getPlan() const {
+		return this->plan;
 	}
-	for (size_t i = 0; i < a.graph.size(); i++) {
-		if (!found(a.arrivalArea, a.graph[i].second)) {
-			a.graph.erase(a.graph.begin() + (ptrdiff_t)i);
-			--i;
-		}
+	
+	/**
+	 * @brief Оптимизация и исполнение плана
+	 *
+	 * @return Accordance результат запроса
+	 */
+	[[nodiscard]] Accordance evaluate() const {
+		QueryPlan optimized = optimizeQuery(this->plan);
+		QueryExecutor executor;
+		const QueryExecutor::Result &result = executor.evaluate(*optimized);
+		
+		return Accordance(
+				IntVector(result.departureArea, currentMemoryResource),
+				IntVector(result.arrivalArea, currentMemoryResource),
+				PairVector(*result.graph, currentMemoryResource)
+		);
 	}
-	
-	return a;
+};
+
+AccordanceQuery unite(const AccordanceQuery &x, const AccordanceQuery &y) {
+	return AccordanceQuery(makeQueryNode(QueryOperation::Unite, x.getPlan(), y.getPlan()));
 }
 
-/**
- * @brief Инверсия соответствия X
- *
- * @param x соответствие X
- * @return Accordance соотв-ие, являющееся инверсией соответствия X
- */
-Accordance inverse(const Accordance &x) {
-	return Accordance(
-			x.getArrivalArea(),
-			x.getDepartureArea(),
-			inversion(x.getGraph())
-	);
+AccordanceQuery intersect(const AccordanceQuery &x, const AccordanceQuery &y) {
+	return AccordanceQuery(makeQueryNode(QueryOperation::Intersect, x.getPlan(), y.getPlan()));
 }
 
-/**
- * @brief Композиция двух соответствий
- *
- * @param x первое соответствие
- * @param y второе соответствие
- * @return Accordance соотв-ие, являющееся композицией соответствий X и Y
- */
-Accordance composition(const Accordance &x, const Accordance &y) {
-	return Accordance(
-			x.getDepartureArea(),
-			y.getArrivalArea(),
-			composition(x.getGraph(), y.getGraph())
-	);
+AccordanceQuery difference(const AccordanceQuery &x, const AccordanceQuery &y) {
+	return AccordanceQuery(makeQueryNode(QueryOperation::Difference, x.getPlan(), y.getPlan()));
+}
+
+AccordanceQuery inverse(const AccordanceQuery &x) {
+	return AccordanceQuery(makeQueryNode(QueryOperation::Inverse, x.getPlan()));
+}
+
+AccordanceQuery composition(const AccordanceQuery &x, const AccordanceQuery &y) {
+	return AccordanceQuery(makeQueryNode(QueryOperation::Composition, x.getPlan(), y.getPlan()));
 }
 
 /**
- * @brief Ввод элементов множества целых чисел
+ * @brief Ввод множества целых чисел. Множества, заданные высказыванием,
+ *        не материализуются
  *
  * @param s множество
- * @param name имя множества
+ * @param message имя множества
  */
-void inputSet(std::vector<int>& s, const std::string& message)
+void inputSet(SymbolicSet& s, const std::string& message)
 {
+	OperationTimer timer("inputSet", 0);
 	int option = -1;
 	while (!(1 <= option && option <= 2)) {
 		std::cout << "Выберите способ задания множества" << message << ":\n"
@@ -512,16 +3792,13 @@ void inputSet(std::vector<int>& s, const std::string& message)
 				          "множества): ";
 				size_t size;
 				std::cin >> size;
-				s.reserve(size);
+				std::vector<int> elements(size);
 				
 				std::cout << "Введите множество:\n";
-				for (int i = 0; i < size; i++) {
-					int x;
-					std::cin >> x;
-					if (!found(s, x)) {
-						s.push_back(x);
-					}
+				for (size_t i = 0; i < size; i++) {
+					std::cin >> elements[i];
 				}
+				s = SymbolicSet(std::move(elements));
 			}
 				break;
 			case 2: {
@@ -534,48 +3811,28 @@ void inputSet(std::vector<int>& s, const std::string& message)
 					             "3. Нечётные числа в промежутке [a;b].\n"
 					             "4. Натуральные числа в промежутке [a;b].\n";
 					std::cin >> option1;
-					int a, b;
+					if (!(1 <= option1 && option1 <= 4)) {
+						std::cout << "Выберите один из предложенных вариантов!\n";
+						continue;
+					}
+					
+					long long a, b;
+					std::cout << "Введите a: ";
+					std::cin >> a;
+					std::cout << "Введите b: ";
+					std::cin >> b;
 					switch (option1) {
 						case 1:
-							std::cout << "Введите a: ";
-							std::cin >> a;
-							std::cout << "Введите b: ";
-							std::cin >> b;
-							for (int i = a; i <= b; i++) {
-								s.push_back(i * i);
-							}
+							s = SymbolicSet::squares(a, b);
 							break;
 						case 2:
-							std::cout << "Введите a: ";
-							std::cin >> a;
-							std::cout << "Введите b: ";
-							std::cin >> b;
-							a += (a % 2);
-							for (int i = a; i <= b; i += 2) {
-								s.push_back(i);
-							}
+							s = SymbolicSet::progression(a, b, 2, 0);
 							break;
 						case 3:
-							std::cout << "Введите a: ";
-							std::cin >> a;
-							std::cout << "Введите b: ";
-							std::cin >> b;
-							a += ((a + 1) % 2);
-							for (int i = a; i <= b; i += 2) {
-								s.push_back(i);
-							}
-							break;
-						case 4:
-							std::cout << "Введите a: ";
-							std::cin >> a;
-							std::cout << "Введите b: ";
-							std::cin >> b;
-							for (int i = a; i <= b; i++) {
-								s.push_back(i);
-							}
+							s = SymbolicSet::progression(a, b, 2, 1);
 							break;
 						default:
-							std::cout << "Выберите один из предложенных вариантов!\n";
+							s = SymbolicSet::progression(a, b);
 					}
 				}
 			}
@@ -586,6 +3843,19 @@ void inputSet(std::vector<int>& s, const std::string& message)
 	}
 }
 
+/**
+ * @brief Ввод элементов множества целых чисел
+ *
+ * @param s множество
+ * @param message имя множества
+ */
+void inputSet(std::vector<int>& s, const std::string& message)
+{
+	SymbolicSet symbolic;
+	inputSet(symbolic, message);
+	symbolic.appendTo(s);
+}
+
 /**
  * @brief Ввод элементов графика
  *
@@ -594,6 +3864,7 @@ void inputSet(std::vector<int>& s, const std::string& message)
  */
 void inputGraph(std::vector< std::pair<int, int> >& g)
 {
+	OperationTimer timer("inputGraph", 0);
 	std::cout << "Введите размер графика соответствия (помните, что после "
 	             "ввода повторяющиеся элементы графика удаляются, что может "
 	             "привести к несоответствию желаемых и действительных размеров "
@@ -615,6 +3886,141 @@ void inputGraph(std::vector< std::pair<int, int> >& g)
 	}
 }
 
+/**
+ * @brief Соответствие по отсортированному списку заданных ячеек матрицы
+ *        (номер строки, номер столбца): повторы удаляются, области
+ *        отправления и прибытия - непустые строки и столбцы, как в
+ *        конструкторе по полной матрице. Память пропорциональна числу ячеек
+ *
+ * @param cells ячейки матрицы, отсортированные по строкам и столбцам
+ * @return Accordance соответствие
+ */
+Accordance sortedCellsAccordance(PairVector &&cells) {
+	OperationTimer timer("sortedCellsAccordance", cells.size());
+	cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+	IntVector rows = projection(cells, &std::pair<int, int>::first);
+	IntVector columns = projection(cells, &std::pair<int, int>::second);
+	return Accordance(Accordance::Sorted(), std::move(rows), std::move(columns), std::move(cells));
+}
+
+/**
+ * @brief Ввод номера ячейки матрицы с проверкой границ
+ *
+ * @param size число строк или столбцов, не больше INT_MAX
+ * @return true если номер прочитан и лежит в [1; size]
+ */
+bool readIndex(int &index, size_t size) {
+	long long value;
+	if (!(std::cin >> value) || value < 1 || (unsigned long long)value > size) {
+		return false;
+	}
+	index = (int)value;
+	return true;
+}
+
+/**
+ * @brief Ввод матрицы соответствия в координатном формате: число заданных
+ *        ячеек и их номера (строка, столбец). Ячейки собираются сразу в
+ *        график, полная матрица не строится
+ *
+ * @param n количество строк
+ * @param m количество столбцов
+ * @return Accordance соответствие
+ */
+Accordance inputCoordinateMatrix(size_t n, size_t m) {
+	OperationTimer timer("inputCoordinateMatrix", 0);
+	std::cout << "Введите количество заданных (единичных) ячеек матрицы: ";
+	size_t count;
+	std::cin >> count;
+	
+	// Память под ячейки не резервируется по введённому числу: оно не проверено
+	std::cout << "Введите номера строки и столбца каждой ячейки:\n";
+	PairVector cells(currentMemoryResource);
+	size_t skipped = 0;
+	for (size_t k = 0; k < count && std::cin; k++) {
+		int i, j;
+		bool valid = readIndex(i, n);
+		valid = readIndex(j, m) && valid;
+		if (valid) {
+			cells.emplace_back(i, j);
+		} else {
+			skipped++;
+		}
+	}
+	if (skipped > 0) {
+		std::cout << "Ячеек за пределами матрицы пропущено: " << skipped << "\n";
+	}
+	
+	parallelSort(cells);
+	return sortedCellsAccordance(std::move(cells));
+}
+
+/**
+ * @brief Ввод матрицы соответствия в построчно сжатом формате (CSR): число
+ *        заданных ячеек, n + 1 смещений начала строк в массиве столбцов и
+ *        сам массив номеров столбцов. Строки идут по порядку, поэтому
+ *        график получается отсортированным после сортировки каждой строки.
+ *        Смещения читаются потоком, запоминаются только непустые строки,
+ *        поэтому память пропорциональна числу ячеек, а не строк
+ *
+ * @param n количество строк
+ * @param m количество столбцов
+ * @return Accordance соответствие
+ */
+Accordance inputCompressedMatrix(size_t n, size_t m) {
+	OperationTimer timer("inputCompressedMatrix", 0);
+	std::cout << "Введите количество заданных (единичных) ячеек матрицы: ";
+	size_t count;
+	std::cin >> count;
+	
+	// Непустые строки: (номер строки, число ячеек в ней)
+	std::vector< std::pair<size_t, size_t> > rows;
+	bool valid = false;
+	while (!valid && std::cin) {
+		std::cout << "Введите " << n + 1 << " смещений начала строк (первое - 0, последнее - " << count << "):\n";
+		rows.clear();
+		size_t previous = 0;
+		valid = true;
+		for (size_t i = 0; i <= n && std::cin; i++) {
+			size_t offset = 0;
+			std::cin >> offset;
+			valid = valid && ((i == 0) ? offset == 0 : previous <= offset);
+			if (valid && i > 0 && previous < offset) {
+				rows.emplace_back(i - 1, offset - previous);
+			}
+			previous = offset;
+		}
+		valid = valid && std::cin && previous == count;
+		if (!valid && std::cin) {
+			std::cout << "Смещения должны не убывать от 0 до " << count << "!\n";
+		}
+	}
+	if (!valid) {
+		return Accordance();
+	}
+	
+	std::cout << "Введите номера столбцов заданных ячеек по строкам:\n";
+	PairVector cells(currentMemoryResource);
+	size_t skipped = 0;
+	for (const std::pair<size_t, size_t> &row : rows) {
+		size_t rowStart = cells.size();
+		for (size_t k = 0; k < row.second && std::cin; k++) {
+			int j;
+			if (readIndex(j, m)) {
+				cells.emplace_back((int)(1 + row.first), j);
+			} else {
+				skipped++;
+			}
+		}
+		std::sort(cells.begin() + (ptrdiff_t)rowStart, cells.end());
+	}
+	if (skipped > 0) {
+		std::cout << "Ячеек за пределами матрицы пропущено: " << skipped << "\n";
+	}
+	
+	return sortedCellsAccordance(std::move(cells));
+}
+
 /**
  * @brief Ввод соответствия
  *
@@ -622,20 +4028,23 @@ void inputGraph(std::vector< std::pair<int, int> >& g)
  * @param name имя соответствия
  */
 void inputAccordance(Accordance &a, const std::string &name) {
+	OperationTimer timer("inputAccordance", 0);
 	int option = -1;
-	while (!(1 <= option && option <= 3)) {
+	while (!(1 <= option && option <= 5)) {
 		std::cout << "Выберите способ задания соответствия " << name << ":\n"
 		                                                                "1. Теоретический.\n"
 		                                                                "2. Матричный.\n"
-		                                                                "3. Графический.\n";
+		                                                                "3. Графический.\n"
+		                                                                "4. Матричный, координатный формат (только единичные ячейки).\n"
+		                                                                "5. Матричный, построчно сжатый формат (CSR).\n";
 		std::cin >> option;
 		
 		switch (option) {
 			case 1:
 			{
-				std::vector<int> x;
+				SymbolicSet x;
 				inputSet(x, ", являющегося областью отправления соответствия " + name);
-				std::vector<int> y;
+				SymbolicSet y;
 				inputSet(y, ", являющегося областью прибытия соответствия " + name);
 				std::vector< std::pair<int, int> > g;
 				inputGraph(g);
@@ -688,6 +4097,26 @@ void inputAccordance(Accordance &a, const std::string &name) {
 				a = Accordance(g);
 			}
 				break;
+			case 4:
+			case 5:
+			{
+				long long n, m;
+				std::cout << "Введите количество строк матрицы соответствия: ";
+				std::cin >> n;
+				std::cout << "Введите количество столбцов матрицы соответствия: ";
+				std::cin >> m;
+				if (!std::cin) {
+					return;
+				}
+				if (n < 0 || m < 0 || n > INT_MAX || m > INT_MAX) {
+					std::cout << "Размеры матрицы должны быть от 0 до " << INT_MAX << "!\n";
+					option = -1;
+					break;
+				}
+				
+				a = (option == 4) ? inputCoordinateMatrix((size_t)n, (size_t)m) : inputCompressedMatrix((size_t)n, (size_t)m);
+			}
+				break;
 			default:
 				std::cout << "Выберите один из предложенных вариантов!\n";
 		}
@@ -700,8 +4129,9 @@ void inputAccordance(Accordance &a, const std::string &name) {
  * @tparam T тип элементов в множестве
  * @param s множество
  */
-template<typename T>
-void printSet(const std::vector<T>& s) {
+template<typename T, typename Allocator>
+void printSet(const std::vector<T, Allocator>& s) {
+	OperationTimer timer("printSet", s.size());
 	std::cout << "{ ";
 	for (size_t i = 0; i < s.size(); i++) {
 		std::cout << s[i] << ((i + 1 != s.size()) ? ", " : " ");
@@ -714,10 +4144,12 @@ void printSet(const std::vector<T>& s) {
  *
  * @param g график
  */
-void printGraph(const std::vector< std::pair<int, int> >& g)
+template<typename Allocator>
+void printGraph(const std::vector< std::pair<int, int>, Allocator >& g)
 {
+	OperationTimer timer("printGraph", g.size());
 	std::cout << "{ ";
-	for (int i = 0; i < g.size(); i++)
+	for (size_t i = 0; i < g.size(); i++)
 	{
 		std::cout << "<" << g[i].first << ", " << g[i].second << ">";
 		if (i + 1 < g.size())
@@ -735,6 +4167,7 @@ void printGraph(const std::vector< std::pair<int, int> >& g)
  * @param name имя соответствия
  */
 void printAccordance(const Accordance &a, const std::string &name) {
+	OperationTimer timer("printAccordance", a.getGraph().size());
 	std::cout << "Характеристика соответствия " << name << ":\n";
 	
 	std::cout << "1. Область отправления соответствия:\n";
@@ -802,9 +4235,593 @@ void printAccordance(const Accordance &a, const std::string &name) {
 	}
 }
 
-int main() {
+#if defined(__unix__) || defined(__APPLE__)
+
+/**
+ * @brief Индекс графика: образы (или прообразы) каждого элемента лежат
+ *        подряд в одном массиве, элемент ищется двоичным поиском. Строится
+ *        один раз за O(n log n), запрос - O(log n + размер ответа)
+ */
+class GraphIndex {
+private:
+	std::vector<int> keys;
+	std::vector<size_t> offsets; // значения keys[i] - values[offsets[i]..offsets[i + 1])
+	std::vector<int> values;
+	bool single = true; // у каждого ключа не больше одного значения (с учётом повторов пар)
+
+public:
+	GraphIndex() = default;
+	
+	/**
+	 * @brief Индекс по первым (byFirst = true) или по вторым элементам пар
+	 */
+	GraphIndex(const PairVector &graph, bool byFirst) {
+		std::vector< std::pair<int, int> > pairs;
+		pairs.reserve(graph.size());
+		for (const std::pair<int, int> &current : graph) {
+			pairs.push_back(byFirst ? current : inversion(current));
+		}
+		std::sort(pairs.begin(), pairs.end());
+		
+		this->values.reserve(pairs.size());
+		for (size_t i = 0; i < pairs.size(); i++) {
+			if (i == 0 || pairs[i].first != pairs[i - 1].first) {
+				this->keys.push_back(pairs[i].first);
+				this->offsets.push_back(i);
+			} else {
+				this->single = false;
+			}
+			this->values.push_back(pairs[i].second);
+		}
+		this->offsets.push_back(pairs.size());
+	}
+	
+	[[nodiscard]] const std::vector<int> &getKeys() const {
+		return this->keys;
+	}
+	
+	[[nodiscard]] bool isSingle() const {
+		return this->single;
+	}
+	
+	/**
+	 * @brief Обход значений ключа key
+	 */
+	template<typename Visit>
+	void forEach(int key, Visit visit) const {
+		size_t i = branchlessLowerBound(this->keys.data(), this->keys.size(), key);
+		if (i == this->keys.size() || this->keys[i] != key) {
+			return;
+		}
+		for (size_t j = this->offsets[i]; j < this->offsets[i + 1]; j++) {
+			visit(this->values[j]);
+		}
+	}
+	
+	/**
+	 * @brief Отсортированное множество значений всех ключей из elements
+	 */
+	[[nodiscard]] std::vector<int> collect(const std::vector<int> &elements) const {
+		std::vector<int> result;
+		for (int element : elements) {
+			this->forEach(element, [&result](int value) {
+				result.push_back(value);
+			});
+		}
+		std::sort(result.begin(), result.end());
+		result.erase(std::unique(result.begin(), result.end()), result.end());
+		return result;
+	}
+};
+
+/**
+ * @brief Соответствие, хранимое сервером: индексы по обоим элементам пар и
+ *        свойства соответствия вычисляются один раз при загрузке. Объект
+ *        не меняется после создания, поэтому читается без блокировок
+ */
+struct ResidentAccordance {
+	Accordance accordance;
+	GraphIndex forward;
+	GraphIndex backward;
+	bool everywhereDefined;
+	bool surjective;
+	
+	explicit ResidentAccordance(Accordance a)
+			: accordance(std::move(a)),
+			  forward(this->accordance.getGraph(), true),
+			  backward(this->accordance.getGraph(), false) {
+		const IntVector &x = this->accordance.getDepartureArea(), &y = this->accordance.getArrivalArea();
+		const std::vector<int> &definition = this->forward.getKeys(), &value = this->backward.getKeys();
+		this->everywhereDefined = std::equal(definition.begin(), definition.end(), x.begin(), x.end());
+		this->surjective = std::equal(value.begin(), value.end(), y.begin(), y.end());
+	}
+};
+
+/**
+ * @brief Именованные соответствия сервера. Читатели под разделяемой
+ *        блокировкой только берут указатель на неизменяемый объект и дальше
+ *        работают с ним без блокировок; писатель строит новый объект вне
+ *        блокировки и подменяет указатель (схема копирования при обновлении).
+ *        Снимки и правки идут через версии со структурным разделением:
+ *        снимок разделяет с оригиналом все части, правка копирует одну
+ *        часть, а индексы новой версии строятся при первом чтении
+ */
+class AccordanceStore {
+private:
+	/**
+	 * @brief Запись хранилища. Есть хотя бы одно из двух: индексы (нет у
+	 *        ещё не прочитанной версии после правки) и версия со структурным
+	 *        разделением (появляется при первом снимке или правке).
+	 *        generation меняется при каждой подмене записи
+	 */
+	struct Entry {
+		std::shared_ptr<const ResidentAccordance> resident;
+		std::shared_ptr<const PersistentAccordance> version;
+		uint64_t generation = 0;
+	};
+	
+	mutable std::shared_mutex mutex;
+	std::unordered_map<std::string, Entry> objects;
+	uint64_t generations = 0;
+	
+	[[nodiscard]] Entry find(const std::string &name) const {
+		std::shared_lock<std::shared_mutex> lock(this->mutex);
+		auto it = this->objects.find(name);
+		if (it == this->objects.end()) {
+			throw std::invalid_argument("нет соответствия " + name);
+		}
+		return it->second;
+	}
+	
+	/**
+	 * @brief Версия записи: строится вне блокировки, если её ещё нет, и
+	 *        запоминается, если запись за это время не подменили
+	 */
+	void ensureVersion(const std::string &name, Entry &entry) {
+		if (entry.version) {
+			return;
+		}
+		entry.version = std::make_shared<const PersistentAccordance>(entry.resident->accordance);
+		std::unique_lock<std::shared_mutex> lock(this->mutex);
+		auto it = this->objects.find(name);
+		if (it != this->objects.end() && it->second.generation == entry.generation) {
+			it->second.version = entry.version;
+		}
+	}
+
+public:
+	/**
+	 * @brief Индексы соответствия; у версии после правки строятся вне
+	 *        блокировки и запоминаются
+	 */
+	[[nodiscard]] std::shared_ptr<const ResidentAccordance> get(const std::string &name) {
+		Entry entry = this->find(name);
+		if (entry.resident) {
+			return entry.resident;
+		}
+		
+		OperationTimer timer("buildIndex", entry.version->getGraph().size());
+		auto resident = std::make_shared<const ResidentAccordance>(entry.version->toAccordance());
+		std::unique_lock<std::shared_mutex> lock(this->mutex);
+		auto it = this->objects.find(name);
+		if (it != this->objects.end() && it->second.generation == entry.generation) {
+			it->second.resident = resident;
+		}
+		return resident;
+	}
+	
+	void put(const std::string &name, Accordance a) {
+		OperationTimer timer("buildIndex", a.getGraph().size());
+		auto resident = std::make_shared<const ResidentAccordance>(std::move(a));
+		std::unique_lock<std::shared_mutex> lock(this->mutex);
+		this->objects[name] = Entry{std::move(resident), nullptr, ++this->generations};
+	}
+	
+	/**
+	 * @brief Снимок соответствия source под именем name: обе записи
+	 *        разделяют версию и индексы, пока одну из них не изменят
+	 *
+	 * @return size_t число пар снимка
+	 */
+	size_t snapshot(const std::string &name, const std::string &source) {
+		Entry entry = this->find(source);
+		this->ensureVersion(source, entry);
+		std::unique_lock<std::shared_mutex> lock(this->mutex);
+		entry.generation = ++this->generations;
+		this->objects[name] = entry;
+		return entry.version->getGraph().size();
+	}
+	
+	/**
+	 * @brief Правка соответствия новой версией: edit меняет снимок текущей
+	 *        версии и возвращает, изменился ли он. Если запись подменили во
+	 *        время правки, правка повторяется над новой версией
+	 *
+	 * @return size_t число пар после правки
+	 */
+	template<typename Edit>
+	size_t edit(const std::string &name, Edit edit) {
+		while (true) {
+			Entry entry = this->find(name);
+			this->ensureVersion(name, entry);
+			PersistentAccordance next = entry.version->snapshot();
+			bool changed = edit(next);
+			
+			std::unique_lock<std::shared_mutex> lock(this->mutex);
+			auto it = this->objects.find(name);
+			if (it == this->objects.end()) {
+				throw std::invalid_argument("нет соответствия " + name);
+			}
+			if (it->second.generation != entry.generation) {
+				continue;
+			}
+			if (changed) {
+				it->second = Entry{nullptr, std::make_shared<const PersistentAccordance>(std::move(next)),
+				                   ++this->generations};
+			}
+			return it->second.version->getGraph().size();
+		}
+	}
+	
+	bool erase(const std::string &name) {
+		std::unique_lock<std::shared_mutex> lock(this->mutex);
+		return this->objects.erase(name) != 0;
+	}
+	
+	[[nodiscard]] std::vector<std::string> names() const {
+		std::shared_lock<std::shared_mutex> lock(this->mutex);
+		std::vector<std::string> result;
+		for (const auto &entry : this->objects) {
+			result.push_back(entry.first);
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+};
+
+/**
+ * @brief Чтение соответствия в двоичном формате генератора (gen --binary accordance)
+ */
+Accordance readAccordanceFile(const std::string &path) {
+	std::ifstream in(path, std::ios::binary);
+	char magic[4];
+	uint32_t version, kind, reserved;
+	uint64_t n, m, count;
+	in.read(magic, 4);
+	in.read(reinterpret_cast<char *>(&version), sizeof(version));
+	in.read(reinterpret_cast<char *>(&kind), sizeof(kind));
+	in.read(reinterpret_cast<char *>(&reserved), sizeof(reserved));
+	in.read(reinterpret_cast<char *>(&n), sizeof(n));
+	in.read(reinterpret_cast<char *>(&m), sizeof(m));
+	in.read(reinterpret_cast<char *>(&count), sizeof(count));
+	if (!in || std::memcmp(magic, "STFB", 4) != 0 || version != 1 || kind != 2) {
+		throw std::invalid_argument("файл " + path + " не является соответствием в двоичном формате");
+	}
+	
+	std::vector<int32_t> raw(2 * count);
+	in.read(reinterpret_cast<char *>(raw.data()), (std::streamsize)(raw.size() * sizeof(int32_t)));
+	if (!in) {
+		throw std::invalid_argument("файл " + path + " обрезан");
+	}
+	
+	IntVector x(n), y(m);
+	std::iota(x.begin(), x.end(), 1);
+	std::iota(y.begin(), y.end(), 1);
+	PairVector graph(count);
+	for (size_t i = 0; i < count; i++) {
+		graph[i] = {raw[2 * i], raw[2 * i + 1]};
+	}
+	return Accordance(Accordance::Parallel(), std::move(x), std::move(y), std::move(graph));
+}
+
+/**
+ * @brief Чтение множества в виде "размер элементы..."
+ */
+std::vector<int> readCountedSet(std::istream &in) {
+	size_t size;
+	if (!(in >> size)) {
+		throw std::invalid_argument("ожидался размер множества");
+	}
+	std::vector<int> result(size);
+	for (int &element : result) {
+		if (!(in >> element)) {
+			throw std::invalid_argument("не хватает элементов множества");
+		}
+	}
+	return result;
+}
+
+void writeSet(std::ostream &out, const std::vector<int> &s) {
+	out << s.size();
+	for (int element : s) {
+		out << ' ' << element;
+	}
+}
+
+/**
+ * @brief Выполнение одного запроса сервера. Запросы (одна строка):
+ *        load ИМЯ |X| x... |Y| y... |G| a b ...   загрузка соответствия
+ *        loadfile ИМЯ путь                         загрузка из файла генератора
+ *        unite|intersect|difference|compose ИТОГ A B
+ *        inverse ИТОГ A
+ *        match ИТОГ A                              наибольшее взаимно однозначное подсоответствие
+ *        snapshot ИТОГ A                           снимок A, разделяющий с ним память
+ *        addpair|removepair ИМЯ a b                правка графика новой версией
+ *        image|prototype ИМЯ k e...                образ или прообраз множества
+ *        analyze ИМЯ                               свойства соответствия
+ *        show ИМЯ, drop ИМЯ, list
+ *        Ответ - одна строка "ok ..." или "error описание"
+ *
+ * @param store хранилище соответствий
+ * @param request запрос
+ * @return std::string ответ (с переводом строки)
+ */
+std::string handleRequest(AccordanceStore &store, const std::string &request) {
+	OperationTimer timer("handleRequest", request.size());
+	std::istringstream in(request);
+	std::ostringstream out;
+	std::string command, name;
+	in >> command;
+	
+	try {
+		if (command == "load") {
+			in >> name;
+			std::vector<int> x = readCountedSet(in), y = readCountedSet(in);
+			size_t size;
+			if (!(in >> size)) {
+				throw std::invalid_argument("ожидался размер графика");
+			}
+			std::vector< std::pair<int, int> > g(size);
+			for (std::pair<int, int> &current : g) {
+				if (!(in >> current.first >> current.second)) {
+					throw std::invalid_argument("не хватает пар графика");
+				}
+			}
+			store.put(name, Accordance(x, y, g));
+			out << "ok " << g.size();
+		} else if (command == "loadfile") {
+			std::string path;
+			in >> name >> path;
+			Accordance a = readAccordanceFile(path);
+			size_t size = a.getGraph().size();
+			store.put(name, std::move(a));
+			out << "ok " << size;
+		} else if (command == "unite" || command == "intersect" || command == "difference" ||
+		           command == "compose" || command == "inverse" || command == "match") {
+			std::string first, second;
+			in >> name >> first;
+			std::shared_ptr<const ResidentAccordance> a = store.get(first), b = a;
+			if (command != "inverse" && command != "match") {
+				in >> second;
+				b = store.get(second);
+			}
+			
+			Accordance result;
+			if (command == "unite") {
+				result = unite(a->accordance, b->accordance);
+			} else if (command == "intersect") {
+				result = intersect(a->accordance, b->accordance);
+			} else if (command == "difference") {
+				result = difference(a->accordance, b->accordance);
+			} else if (command == "compose") {
+				result = composition(a->accordance, b->accordance);
+			} else if (command == "match") {
+				result = maximumMatching(a->accordance);
+			} else {
+				result = inverse(a->accordance);
+			}
+			size_t size = result.getGraph().size();
+			store.put(name, std::move(result));
+			out << "ok " << size;
+		} else if (command == "snapshot") {
+			std::string source;
+			in >> name >> source;
+			out << "ok " << store.snapshot(name, source);
+		} else if (command == "addpair" || command == "removepair") {
+			int x, y;
+			in >> name;
+			if (!(in >> x >> y)) {
+				throw std::invalid_argument("ожидалась пара");
+			}
+			bool add = (command == "addpair");
+			out << "ok " << store.edit(name, [add, x, y](PersistentAccordance &version) {
+				return add ? version.addPair(x, y) : version.removePair(x, y);
+			});
+		} else if (command == "image" || command == "prototype") {
+			in >> name;
+			std::shared_ptr<const ResidentAccordance> a = store.get(name);
+			std::vector<int> elements = readCountedSet(in);
+			out << "ok ";
+			writeSet(out, (command == "image") ? a->forward.collect(elements) : a->backward.collect(elements));
+		} else if (command == "analyze") {
+			in >> name;
+			std::shared_ptr<const ResidentAccordance> a = store.get(name);
+			bool functional = a->forward.isSingle(), injective = a->backward.isSingle();
+			out << "ok everywhereDefined=" << a->everywhereDefined << " surjective=" << a->surjective <<
+			    " functional=" << functional << " injective=" << injective <<
+			    " mappingIn=" << (a->everywhereDefined && functional) <<
+			    " mappingTo=" << (a->everywhereDefined && functional && a->surjective) <<
+			    " oneToOne=" << (functional && injective) <<
+			    " bijection=" << (a->everywhereDefined && a->surjective && functional && injective);
+		} else if (command == "show") {
+			in >> name;
+			std::shared_ptr<const ResidentAccordance> a = store.get(name);
+			const Accordance &accordance = a->accordance;
+			out << "ok ";
+			writeSet(out, std::vector<int>(accordance.getDepartureArea().begin(), accordance.getDepartureArea().end()));
+			out << ' ';
+			writeSet(out, std::vector<int>(accordance.getArrivalArea().begin(), accordance.getArrivalArea().end()));
+			out << ' ' << accordance.getGraph().size();
+			for (const std::pair<int, int> &current : accordance.getGraph()) {
+				out << ' ' << current.first << ' ' << current.second;
+			}
+		} else if (command == "drop") {
+			in >> name;
+			out << (store.erase(name) ? "ok" : "error нет соответствия " + name);
+		} else if (command == "list") {
+			out << "ok";
+			for (const std::string &current : store.names()) {
+				out << ' ' << current;
+			}
+		} else {
+			out << "error неизвестный запрос " << command;
+		}
+	} catch (const std::exception &e) {
+		out.str("");
+		out << "error " << e.what();
+	}
+	
+	out << '\n';
+	return out.str();
+}
+
+// Наибольшая длина строки запроса: клиент, не присылающий перевода строки,
+// не должен неограниченно раздувать память сервера
+const size_t MAX_REQUEST_LENGTH = 1 << 26;
+
+/**
+ * @brief Обслуживание одного клиента: запросы читаются построчно, ответ
+ *        отправляется на каждую строку. Слишком длинная строка запроса
+ *        получает ошибку, и соединение закрывается
+ */
+void serveConnection(AccordanceStore &store, int client) {
+	std::string pending;
+	char buffer[1 << 16];
+	ssize_t received;
+	while ((received = read(client, buffer, sizeof(buffer))) > 0) {
+		pending.append(buffer, (size_t)received);
+		if (pending.size() > MAX_REQUEST_LENGTH && pending.find('\n') == std::string::npos) {
+			const char tooLong[] = "error слишком длинный запрос\n";
+			ssize_t ignored = write(client, tooLong, sizeof(tooLong) - 1);
+			(void)ignored;
+			break;
+		}
+		size_t start = 0, end;
+		while ((end = pending.find('\n', start)) != std::string::npos) {
+			std::string response = handleRequest(store, pending.substr(start, end - start));
+			for (size_t sent = 0; sent < response.size();) {
+				ssize_t written = write(client, response.data() + sent, response.size() - sent);
+				if (written <= 0) {
+					close(client);
+					return;
+				}
+				sent += (size_t)written;
+			}
+			start = end + 1;
+		}
+		pending.erase(0, start);
+	}
+	close(client);
+}
+
+// Наибольшее число одновременно обслуживаемых клиентов сервера
+const size_t MAX_SERVER_CONNECTIONS = 64;
+
+/**
+ * @brief Режим сервера: соответствия остаются в памяти между запросами,
+ *        каждый клиент Unix-сокета обслуживается в своём потоке. Клиентам
+ *        сверх MAX_SERVER_CONNECTIONS сразу отвечается ошибкой. SIGPIPE
+ *        игнорируется, чтобы клиент, закрывший сокет до получения ответов,
+ *        не завершал сервер вместе со всеми соответствиями. Существующий
+ *        файл по пути сокета удаляется, только если это сокет
+ *
+ * @param path путь к сокету
+ * @return int код завершения программы
+ */
+int runServer(const std::string &path) {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		std::cerr << "Слишком длинный путь к сокету " << path << '\n';
+		return EXIT_FAILURE;
+	}
+	std::strcpy(address.sun_path, path.c_str());
+	
+	struct stat existing{};
+	if (lstat(path.c_str(), &existing) == 0) {
+		if (!S_ISSOCK(existing.st_mode)) {
+			std::cerr << "Файл " << path << " существует и не является сокетом\n";
+			return EXIT_FAILURE;
+		}
+		unlink(path.c_str()); // сокет, оставшийся от прошлого запуска
+	}
+	
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) {
+		std::perror("socket");
+		return EXIT_FAILURE;
+	}
+	if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0) {
+		std::perror(path.c_str());
+		close(listener);
+		return EXIT_FAILURE;
+	}
+	
+	signal(SIGPIPE, SIG_IGN);
+	std::cerr << "Сервер соответствий ожидает запросы на " << path << '\n';
+	AccordanceStore store;
+	std::atomic<size_t> connections{0};
+	while (true) {
+		int client = accept(listener, nullptr, nullptr);
+		if (client < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+				// Нехватка ресурсов проходит, когда клиенты отключаются: ждём, а не
+				// крутимся в цикле и не теряем хранимые соответствия
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				continue;
+			}
+			std::perror("accept");
+			close(listener);
+			return EXIT_FAILURE;
+		}
+		if (connections.load() >= MAX_SERVER_CONNECTIONS) {
+			const char busy[] = "error слишком много клиентов\n";
+			ssize_t ignored = write(client, busy, sizeof(busy) - 1);
+			(void)ignored;
+			close(client);
+			continue;
+		}
+		connections++;
+		std::thread([&store, &connections, client]() {
+			serveConnection(store, client);
+			connections--;
+		}).detach();
+	}
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
 	setlocale(LC_ALL, "rus");
 	
+	// --stats - вывод статистики выполнения операций в stderr при выходе,
+	// --trace=файл - запись трассировки операций в файл при выходе
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--stats") == 0) {
+			Statistics::enable();
+		} else if (std::strncmp(argv[i], "--trace=", 8) == 0) {
+			Trace::enable(argv[i] + 8);
+		}
+	}
+	
+	// --server=сокет - соответствия хранятся в памяти и обслуживаются по запросам
+	for (int i = 1; i < argc; i++) {
+		if (std::strncmp(argv[i], "--server=", 9) == 0) {
+#if defined(__unix__) || defined(__APPLE__)
+			return runServer(argv[i] + 9);
+#else
+			std::cerr << "Режим сервера доступен только в Unix-системах.\n";
+			return EXIT_FAILURE;
+#endif
+		}
+	}
+	
+	// Кэш результатов операций живёт дольше отдельных запросов
+	AccordanceCache operationCache;
+	
 	int option = 1;
 	while (1 <= option && option <= 8) {
 		std::cout << "Выберите нужную операцию:\n"
@@ -822,11 +4839,12 @@ int main() {
 		switch (option) {
 			case 1:
 			{
+				Arena arena; // все промежуточные результаты запроса освобождаются разом
 				Accordance a, b;
 				inputAccordance(a, "A");
 				inputAccordance(b, "B");
 				
-				Accordance c = unite(a, b);
+				const Accordance &c = operationCache.compute(AccordanceCache::UNITE, a, b);
 				
 				std::cout << "Результатом объединения соответствий A и B является соответствие С.\n";
 				printAccordance(c, "C");
@@ -834,11 +4852,12 @@ int main() {
 				break;
 			case 2:
 			{
+				Arena arena;
 				Accordance a, b;
 				inputAccordance(a, "A");
 				inputAccordance(b, "B");
 				
-				Accordance c = intersect(a, b);
+				const Accordance &c = operationCache.compute(AccordanceCache::INTERSECT, a, b);
 				
 				std::cout << "Результатом пересечения соответствий A и B является соответствие С.\n";
 				printAccordance(c, "C");
@@ -846,11 +4865,12 @@ int main() {
 				break;
 			case 3:
 			{
+				Arena arena;
 				Accordance a, b;
 				inputAccordance(a, "A");
 				inputAccordance(b, "B");
 				
-				Accordance c = difference(a, b);
+				const Accordance &c = operationCache.compute(AccordanceCache::DIFFERENCE, a, b);
 				
 				std::cout << "Результатом выполнения операции разности на соответствиях A и "
 				             "B является соответствие С.\n";
@@ -859,10 +4879,11 @@ int main() {
 				break;
 			case 4:
 			{
+				Arena arena;
 				Accordance a;
 				inputAccordance(a, "A");
 				
-				Accordance aMinus1 = inverse(a);
+				const Accordance &aMinus1 = operationCache.compute(AccordanceCache::INVERSE, a, a);
 				
 				std::cout << "Инверсией соответствия А является соответствие B.\n";
 				printAccordance(aMinus1, "B");
@@ -870,11 +4891,12 @@ int main() {
 				break;
 			case 5:
 			{
+				Arena arena;
 				Accordance a, b;
 				inputAccordance(a, "A");
 				inputAccordance(b, "B");
 				
-				Accordance c = composition(a, b);
+				const Accordance &c = operationCache.compute(AccordanceCache::COMPOSITION, a, b);
 				
 				std::cout << "Результатом выполнения операции композиции на соответствиях A и "
 				             "B является соответствие С.\n";
@@ -883,6 +4905,7 @@ int main() {
 				break;
 			case 6:
 			{
+				Arena arena;
 				Accordance a;
 				inputAccordance(a, "A");
 				
@@ -891,10 +4914,11 @@ int main() {
 				break;
 			case 7:
 			{
+				Arena arena;
 				Accordance gamma;
 				inputAccordance(gamma, "Г");
 				
-				std::vector<int> a;
+				SymbolicSet a;
 				inputSet(a, " A");
 				
 				std::cout << "Образом множества A при соответствии Г является множество:\n";
@@ -903,10 +4927,11 @@ int main() {
 				break;
 			case 8:
 			{
+				Arena arena;
 				Accordance gamma;
 				inputAccordance(gamma, "Г");
 				
-				std::vector<int> b;
+				SymbolicSet b;
 				inputSet(b, " B");
 				
 				std::cout << "Прообразом множества B при соответствии Г является множество:\n";
@@ -915,6 +4940,8 @@ int main() {
 				break;
 			default:
 				std::cout << "Выход из программы...\n";
+				std::cout << "Кэш операций: попаданий - " << operationCache.getHits() <<
+				          ", промахов - " << operationCache.getMisses() << ".\n";
 		}
 		std::cout << '\n';
 	}
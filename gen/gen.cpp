@@ -0,0 +1,504 @@
+/*
+ * Генератор тестовых данных для лабораторных работ: множества, графики и
+ * соответствия. Одинаковое зерно (--seed) даёт одинаковые данные.
+ *
+ * Использование:
+ *   gen set <n> <max> [--zipf=s]                   n чисел из [1;max], равномерно или по Ципфу
+ *   gen graph random <pairs> <n> <m>               pairs пар из [1;n] x [1;m]
+ *   gen graph powerlaw <pairs> <n> <m> [--zipf=s]  степени вершин распределены по Ципфу
+ *   gen graph dense <n> <m> <density>              каждая пара с вероятностью density
+ *   gen accordance functional|injective|bijective <n> <m>
+ *   gen matrix <n> <m> <density>                   матрица для Accordance(matrix)
+ *
+ * Общие ключи: --seed=N, --binary, --output=файл.
+ *
+ * Текстовый вывод повторяет ответы на запросы программ: для set и graph -
+ * размер и элементы (inputSet, inputGraph), для accordance и matrix - ответы
+ * inputAccordance из 3/3.cpp (способ задания 1 или 2 соответственно).
+ *
+ * Двоичный вывод (порядок байт машины): "STFB", uint32 версия (1), uint32 вид
+ * (0 - set, 1 - graph, 2 - accordance, 3 - matrix), uint32 0, затем
+ *   set:        uint64 count, int32[count]
+ *   graph:      uint64 count, int32[2 * count] (пары подряд)
+ *   accordance: uint64 n, uint64 m, uint64 count, int32[2 * count]
+ *               (области отправления и прибытия - [1;n] и [1;m])
+ *   matrix:     uint64 n, uint64 m, n строк по (m + 7) / 8 байт, бит j
+ *               строки - элемент (i, j), младший бит байта первый
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <charconv>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Генератор псевдослучайных чисел xoshiro256**, зерно раскладывается
+ *        в состояние через splitmix64
+ */
+class Random {
+private:
+	uint64_t state[4];
+
+	static uint64_t rotateLeft(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+
+public:
+	explicit Random(uint64_t seed) {
+		for (uint64_t &word : this->state) {
+			seed += 0x9e3779b97f4a7c15ULL;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			word = z ^ (z >> 31);
+		}
+	}
+
+	uint64_t next() {
+		uint64_t result = rotateLeft(this->state[1] * 5, 7) * 9;
+		uint64_t t = this->state[1] << 17;
+		this->state[2] ^= this->state[0];
+		this->state[3] ^= this->state[1];
+		this->state[1] ^= this->state[2];
+		this->state[0] ^= this->state[3];
+		this->state[2] ^= t;
+		this->state[3] = rotateLeft(this->state[3], 45);
+		return result;
+	}
+
+	/**
+	 * @brief Равномерное целое из [0; bound) умножением со сдвигом (без деления)
+	 */
+	uint64_t below(uint64_t bound) {
+		return (uint64_t)(((unsigned __int128)this->next() * bound) >> 64);
+	}
+
+	/**
+	 * @brief Равномерное вещественное из [0; 1)
+	 */
+	double uniform() {
+		return (double)(this->next() >> 11) * 0x1.0p-53;
+	}
+};
+
+/**
+ * @brief Распределение Ципфа на [1;n] с показателем s: вероятность k
+ *        пропорциональна k^(-s). Выборка методом обратной функции с
+ *        отбраковкой (Hörmann, Derflinger), O(1) на число без таблиц
+ */
+class ZipfDistribution {
+private:
+	uint64_t n;
+	double exponent;
+	double hIntegralX1;
+	double hIntegralN;
+	double squeeze;
+
+	static double helper1(double x) {
+		return (std::fabs(x) > 1e-8) ? std::log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+	}
+
+	static double helper2(double x) {
+		return (std::fabs(x) > 1e-8) ? std::expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+	}
+
+	[[nodiscard]] double h(double x) const {
+		return std::exp(-this->exponent * std::log(x));
+	}
+
+	[[nodiscard]] double hIntegral(double x) const {
+		double logX = std::log(x);
+		return helper2((1 - this->exponent) * logX) * logX;
+	}
+
+	[[nodiscard]] double hIntegralInverse(double x) const {
+		double t = x * (1 - this->exponent);
+		if (t < -1) {
+			t = -1;
+		}
+		return std::exp(helper1(t) * x);
+	}
+
+public:
+	ZipfDistribution(uint64_t n, double exponent)
+			: n(n), exponent(exponent) {
+		this->hIntegralX1 = this->hIntegral(1.5) - 1;
+		this->hIntegralN = this->hIntegral((double)n + 0.5);
+		this->squeeze = 2 - this->hIntegralInverse(this->hIntegral(2.5) - this->h(2));
+	}
+
+	uint64_t operator()(Random &random) const {
+		while (true) {
+			double u = this->hIntegralN + random.uniform() * (this->hIntegralX1 - this->hIntegralN);
+			double x = this->hIntegralInverse(u);
+			double k = std::floor(x + 0.5);
+			if (k < 1) {
+				k = 1;
+			} else if (k > (double)this->n) {
+				k = (double)this->n;
+			}
+			if (k - x <= this->squeeze || u >= this->hIntegral(k + 0.5) - this->h(k)) {
+				return (uint64_t)k;
+			}
+		}
+	}
+};
+
+/**
+ * @brief Буферизованный вывод чисел в текстовом или двоичном виде
+ */
+class Writer {
+private:
+	std::FILE *file;
+	bool binary;
+	std::vector<char> buffer;
+	size_t used = 0;
+
+	void reserve(size_t bytes) {
+		if (this->used + bytes > this->buffer.size()) {
+			this->flush();
+		}
+	}
+
+public:
+	Writer(std::FILE *file, bool binary)
+			: file(file), binary(binary), buffer(1 << 20) {}
+
+	Writer(const Writer &) = delete;
+	Writer &operator=(const Writer &) = delete;
+
+	~Writer() {
+		this->flush();
+	}
+
+	[[nodiscard]] bool isBinary() const {
+		return this->binary;
+	}
+
+	void flush() {
+		if (this->used != 0 && std::fwrite(this->buffer.data(), 1, this->used, this->file) != this->used) {
+			std::perror("gen");
+			std::exit(EXIT_FAILURE);
+		}
+		this->used = 0;
+	}
+
+	void bytes(const void *data, size_t size) {
+		this->reserve(size);
+		std::memcpy(this->buffer.data() + this->used, data, size);
+		this->used += size;
+	}
+
+	template<typename T>
+	void raw(T value) {
+		this->bytes(&value, sizeof(value));
+	}
+
+	void text(const char *s) {
+		this->bytes(s, std::strlen(s));
+	}
+
+	/**
+	 * @brief Число: в двоичном виде int32, в текстовом - с разделителем separator
+	 */
+	void number(long long value, char separator) {
+		if (this->binary) {
+			this->raw((int32_t)value);
+			return;
+		}
+		this->reserve(24);
+		char *begin = this->buffer.data() + this->used;
+		char *end = std::to_chars(begin, begin + 23, value).ptr;
+		*end++ = separator;
+		this->used += (size_t)(end - begin);
+	}
+
+	/**
+	 * @brief Размер: в двоичном виде uint64, в текстовом - строкой
+	 */
+	void count(uint64_t value) {
+		if (this->binary) {
+			this->raw(value);
+		} else {
+			this->number((long long)value, '\n');
+		}
+	}
+
+	void header(uint32_t kind) {
+		if (this->binary) {
+			this->bytes("STFB", 4);
+			this->raw((uint32_t)1);
+			this->raw(kind);
+			this->raw((uint32_t)0);
+		}
+	}
+
+	void pair(long long x, long long y) {
+		this->number(x, ' ');
+		this->number(y, '\n');
+	}
+};
+
+/**
+ * @brief Параметры командной строки: позиционные аргументы и ключи --имя=значение
+ */
+struct Options {
+	std::vector<std::string> positional;
+	uint64_t seed = 1;
+	bool binary = false;
+	double zipf = 0;
+	std::string output;
+
+	Options(int argc, char *argv[]) {
+		for (int i = 1; i < argc; i++) {
+			std::string argument = argv[i];
+			if (argument.rfind("--seed=", 0) == 0) {
+				this->seed = std::stoull(argument.substr(7));
+			} else if (argument == "--binary") {
+				this->binary = true;
+			} else if (argument.rfind("--zipf=", 0) == 0) {
+				this->zipf = std::stod(argument.substr(7));
+			} else if (argument.rfind("--output=", 0) == 0) {
+				this->output = argument.substr(9);
+			} else {
+				this->positional.push_back(argument);
+			}
+		}
+	}
+
+	[[nodiscard]] uint64_t integer(size_t index) const {
+		return std::stoull(this->at(index));
+	}
+
+	[[nodiscard]] double real(size_t index) const {
+		return std::stod(this->at(index));
+	}
+
+	[[nodiscard]] const std::string &at(size_t index) const {
+		if (index >= this->positional.size()) {
+			throw std::invalid_argument("недостаточно аргументов");
+		}
+		return this->positional[index];
+	}
+};
+
+/**
+ * @brief Выбор позиций [0; total), каждая с вероятностью density: следующая
+ *        позиция находится геометрическим прыжком, поэтому время
+ *        пропорционально числу выбранных позиций, а не total
+ */
+template<typename Visit>
+void sampleBernoulli(Random &random, uint64_t total, double density, Visit visit) {
+	if (density <= 0) {
+		return;
+	}
+	if (density >= 1) {
+		for (uint64_t position = 0; position < total; position++) {
+			visit(position);
+		}
+		return;
+	}
+
+	double logMiss = std::log1p(-density);
+	uint64_t position = 0;
+	while (true) {
+		double skip = std::floor(std::log(1 - random.uniform()) / logMiss);
+		if (skip >= (double)(total - position)) {
+			return;
+		}
+		position += (uint64_t)skip;
+		visit(position++);
+	}
+}
+
+/**
+ * @brief Подсчёт числа позиций, выбранных sampleBernoulli с тем же
+ *        состоянием генератора (размер нужен до самих данных)
+ */
+uint64_t countBernoulli(Random random, uint64_t total, double density) {
+	uint64_t count = 0;
+	sampleBernoulli(random, total, density, [&count](uint64_t) {
+		++count;
+	});
+	return count;
+}
+
+void generateSet(const Options &options, Random &random, Writer &out) {
+	uint64_t n = options.integer(1), max = options.integer(2);
+	out.header(0);
+	out.count(n);
+	if (options.zipf > 0) {
+		ZipfDistribution zipf(max, options.zipf);
+		for (uint64_t i = 0; i < n; i++) {
+			out.number((long long)zipf(random), (i + 1 < n) ? ' ' : '\n');
+		}
+	} else {
+		for (uint64_t i = 0; i < n; i++) {
+			out.number(1 + (long long)random.below(max), (i + 1 < n) ? ' ' : '\n');
+		}
+	}
+}
+
+void generateGraph(const Options &options, Random &random, Writer &out) {
+	const std::string &shape = options.at(1);
+	out.header(1);
+
+	if (shape == "dense") {
+		uint64_t n = options.integer(2), m = options.integer(3);
+		double density = options.real(4);
+		out.count(countBernoulli(random, n * m, density));
+		sampleBernoulli(random, n * m, density, [&out, m](uint64_t cell) {
+			out.pair(1 + (long long)(cell / m), 1 + (long long)(cell % m));
+		});
+		return;
+	}
+
+	uint64_t pairs = options.integer(2), n = options.integer(3), m = options.integer(4);
+	out.count(pairs);
+	if (shape == "powerlaw") {
+		double exponent = (options.zipf > 0) ? options.zipf : 1.1;
+		ZipfDistribution from(n, exponent), to(m, exponent);
+		for (uint64_t i = 0; i < pairs; i++) {
+			out.pair((long long)from(random), (long long)to(random));
+		}
+	} else if (shape == "random") {
+		for (uint64_t i = 0; i < pairs; i++) {
+			out.pair(1 + (long long)random.below(n), 1 + (long long)random.below(m));
+		}
+	} else {
+		throw std::invalid_argument("неизвестный вид графика: " + shape);
+	}
+}
+
+/**
+ * @brief Ответы на запрос inputSet(SymbolicSet&) для множества [1;n] (традиционный способ)
+ */
+void writeRangeAnswer(Writer &out, uint64_t n) {
+	out.text("1\n");
+	out.count(n);
+	for (uint64_t i = 1; i <= n; i++) {
+		out.number((long long)i, (i < n) ? ' ' : '\n');
+	}
+}
+
+void generateAccordance(const Options &options, Random &random, Writer &out) {
+	const std::string &kind = options.at(1);
+	uint64_t n = options.integer(2), m = options.integer(3);
+	if ((kind == "injective" && m < n) || (kind == "bijective" && m != n)) {
+		throw std::invalid_argument("для такого соответствия не хватает элементов области прибытия");
+	}
+	if (kind != "functional" && kind != "injective" && kind != "bijective") {
+		throw std::invalid_argument("неизвестный вид соответствия: " + kind);
+	}
+
+	// Образы 1..n: случайные для функционального, без повторов для остальных
+	std::vector<int32_t> image;
+	if (kind != "functional") {
+		image.resize(m);
+		std::iota(image.begin(), image.end(), 1);
+		for (uint64_t i = 0; i < n; i++) {
+			std::swap(image[i], image[i + random.below(m - i)]);
+		}
+	}
+
+	out.header(2);
+	if (out.isBinary()) {
+		out.raw(n);
+		out.raw(m);
+	} else {
+		out.text("1\n");
+		writeRangeAnswer(out, n);
+		writeRangeAnswer(out, m);
+	}
+	out.count(n);
+	for (uint64_t i = 0; i < n; i++) {
+		long long y = image.empty() ? 1 + (long long)random.below(m) : image[i];
+		out.pair(1 + (long long)i, y);
+	}
+}
+
+void generateMatrix(const Options &options, Random &random, Writer &out) {
+	uint64_t n = options.integer(1), m = options.integer(2);
+	double density = options.real(3);
+
+	std::vector<uint8_t> row((m + 7) / 8);
+	uint64_t currentRow = 0;
+	auto flushRows = [&](uint64_t until) {
+		for (; currentRow < until; currentRow++) {
+			if (out.isBinary()) {
+				out.bytes(row.data(), row.size());
+			} else {
+				for (uint64_t j = 0; j < m; j++) {
+					out.text(((row[j / 8] >> (j % 8)) & 1) ? "1" : "0");
+					out.text((j + 1 < m) ? " " : "\n");
+				}
+			}
+			std::fill(row.begin(), row.end(), 0);
+		}
+	};
+
+	out.header(3);
+	if (out.isBinary()) {
+		out.raw(n);
+		out.raw(m);
+	} else {
+		out.text("2\n");
+		out.count(n);
+		out.count(m);
+	}
+	sampleBernoulli(random, n * m, density, [&](uint64_t cell) {
+		flushRows(cell / m);
+		row[(cell % m) / 8] |= (uint8_t)(1u << (cell % m % 8));
+	});
+	flushRows(n);
+}
+
+int main(int argc, char *argv[]) {
+	Options options(argc, argv);
+	if (options.positional.empty()) {
+		std::fputs("Использование: gen set|graph|accordance|matrix ... [--seed=N] [--binary] "
+		           "[--zipf=s] [--output=файл]\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	std::FILE *file = stdout;
+	if (!options.output.empty()) {
+		file = std::fopen(options.output.c_str(), options.binary ? "wb" : "w");
+		if (file == nullptr) {
+			std::perror(options.output.c_str());
+			return EXIT_FAILURE;
+		}
+	}
+
+	try {
+		Random random(options.seed);
+		Writer out(file, options.binary);
+		const std::string &kind = options.positional[0];
+		if (kind == "set") {
+			generateSet(options, random, out);
+		} else if (kind == "graph") {
+			generateGraph(options, random, out);
+		} else if (kind == "accordance") {
+			generateAccordance(options, random, out);
+		} else if (kind == "matrix") {
+			generateMatrix(options, random, out);
+		} else {
+			throw std::invalid_argument("неизвестный вид данных: " + kind);
+		}
+	} catch (const std::exception &e) {
+		std::fprintf(stderr, "gen: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	if (file != stdout) {
+		std::fclose(file);
+	}
+	return EXIT_SUCCESS;
+}